@@ -0,0 +1,524 @@
+/*
+ * Throughput/latency benchmark for /dev/dummy/dummyN.
+ *
+ * Writers send frames stamped with struct dummy_emu_hdr, readers read the
+ * device in framed mode and take the latency of every stamped frame they
+ * get back. Stamps come back with the device in loopback (or with the
+ * emulator: platform_test emulate=1 emu_loopback=1), frames generated by
+ * the emulator carry the same stamp.
+ */
+#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "platform_cdev.h"
+
+#define MAX_THREADS	7	/* MAX_OPEN of the cdev, less the control fd */
+#define MAX_FRAME	4096	/* device window */
+#define MAX_SAMPLES	(1 << 20) /* latency samples kept per reader */
+#define NR_STREAMS	256	/* seq top byte: writer id, 0 for the emulator */
+#define SEQ_MASK	0xffffff
+
+enum bench_mode {
+	MODE_BLOCK,
+	MODE_NONBLOCK,
+	MODE_POLL,
+};
+
+static const char *mode_names[] = {
+	[MODE_BLOCK]	= "block",
+	[MODE_NONBLOCK]	= "nonblock",
+	[MODE_POLL]	= "poll",
+};
+
+struct bench_cfg {
+	char cdev[64];
+	int readers;
+	int writers;
+	uint32_t frame_size;
+	uint32_t interval_us;	/* 0: leave the device as it is */
+	enum bench_mode mode;
+	int seconds;
+	int json;
+};
+
+/*Stamped frames one reader got from one sender, seq unwrapped to 64 bits*/
+struct seq_stream {
+	uint64_t first;
+	uint64_t last;
+	uint64_t frames;
+};
+
+struct bench_thread {
+	pthread_t tid;
+	int fd;
+	int id;
+	uint64_t frames;
+	uint64_t bytes;
+	uint64_t nr_lat;
+	uint64_t *lat;		/* ns, readers only */
+	struct seq_stream *seq;	/* NR_STREAMS, readers only */
+	uint64_t out_of_order;
+	int err;
+};
+
+static struct bench_cfg cfg = {
+	.readers	= 1,
+	.writers	= 1,
+	.frame_size	= 1024,
+	.mode		= MODE_BLOCK,
+	.seconds	= 5,
+};
+
+static volatile sig_atomic_t stop;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*Only there to get blocked syscalls out with EINTR*/
+static void on_signal(int sig)
+{
+	(void)sig;
+}
+
+/*Waits until fd is ready in poll mode, false when the run is over*/
+static int wait_ready(int fd, short events)
+{
+	struct pollfd pfd = { .fd = fd, .events = events };
+
+	if (cfg.mode != MODE_POLL)
+		return !stop;
+
+	while (!stop) {
+		if (poll(&pfd, 1, 100) > 0)
+			return 1;
+	}
+	return 0;
+}
+
+/*Readers see the frames of a sender in order, lower seq than the last is late*/
+static void track_seq(struct bench_thread *t, uint32_t seq)
+{
+	struct seq_stream *s = &t->seq[seq >> 24];
+	int32_t d;
+
+	seq &= SEQ_MASK;
+	if (!s->frames) {
+		s->first = s->last = seq;
+		s->frames = 1;
+		return;
+	}
+
+	/* distance from the last one, sign extended from 24 bits */
+	d = (int32_t)(((seq - (uint32_t)s->last) & SEQ_MASK) << 8) >> 8;
+	if (!d)
+		return;		/* duplicate */
+	s->frames++;
+	if (d > 0) {
+		s->last += d;
+		return;
+	}
+	t->out_of_order++;
+	if (s->last + d < s->first)
+		s->first = s->last + d;
+}
+
+static void *reader(void *arg)
+{
+	struct bench_thread *t = arg;
+	struct dummy_emu_hdr hdr;
+	char *buf;
+	ssize_t n;
+
+	buf = malloc(MAX_FRAME);
+	t->lat = calloc(MAX_SAMPLES, sizeof(*t->lat));
+	t->seq = calloc(NR_STREAMS, sizeof(*t->seq));
+	if (!buf || !t->lat || !t->seq) {
+		t->err = ENOMEM;
+		free(buf);
+		return NULL;
+	}
+
+	while (wait_ready(t->fd, POLLIN)) {
+		n = read(t->fd, buf, MAX_FRAME);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EINTR)
+				continue;
+			t->err = errno;
+			break;
+		}
+
+		t->frames++;
+		t->bytes += n;
+		if (n < (ssize_t)sizeof(hdr))
+			continue;
+		memcpy(&hdr, buf, sizeof(hdr));
+		if (hdr.magic != DUMMY_EMU_MAGIC)
+			continue;
+		track_seq(t, hdr.seq);
+		if (t->nr_lat < MAX_SAMPLES)
+			t->lat[t->nr_lat++] = now_ns() - hdr.ts_ns;
+	}
+
+	free(buf);
+	return NULL;
+}
+
+static void *writer(void *arg)
+{
+	struct bench_thread *t = arg;
+	struct dummy_emu_hdr hdr = { .magic = DUMMY_EMU_MAGIC };
+	uint32_t seq = 0;
+	char *buf;
+	ssize_t n;
+
+	buf = calloc(1, cfg.frame_size);
+	if (!buf) {
+		t->err = ENOMEM;
+		return NULL;
+	}
+
+	while (wait_ready(t->fd, POLLOUT)) {
+		/* writers share the sequence space: thread id in the top byte */
+		hdr.seq = (uint32_t)t->id << 24 | (seq & 0xffffff);
+		hdr.ts_ns = now_ns();
+		memcpy(buf, &hdr, sizeof(hdr));
+
+		n = write(t->fd, buf, cfg.frame_size);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EINTR)
+				continue;
+			t->err = errno;
+			break;
+		}
+		seq++;
+		t->frames++;
+		t->bytes += n;
+	}
+
+	free(buf);
+	return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static uint64_t percentile(const uint64_t *v, uint64_t n, double p)
+{
+	if (!n)
+		return 0;
+	return v[(uint64_t)(p * (n - 1))];
+}
+
+/*Frames missing between the first and last seq any reader got, per sender*/
+static uint64_t seq_lost(struct bench_thread *th)
+{
+	uint64_t lost = 0, first, last, frames;
+	struct seq_stream *s;
+	int i, j;
+
+	for (j = 0; j < NR_STREAMS; j++) {
+		first = UINT64_MAX;
+		last = frames = 0;
+		for (i = 0; i < cfg.readers; i++) {
+			s = &th[i].seq[j];
+			if (!s->frames)
+				continue;
+			if (s->first < first)
+				first = s->first;
+			if (s->last > last)
+				last = s->last;
+			frames += s->frames;
+		}
+		if (frames && last - first + 1 > frames)
+			lost += last - first + 1 - frames;
+	}
+	return lost;
+}
+
+static int open_dev(int framed)
+{
+	int flags = O_RDWR;
+	int fd;
+
+	if (cfg.mode != MODE_BLOCK)
+		flags |= O_NONBLOCK;
+
+	fd = open(cfg.cdev, flags);
+	if (fd < 0) {
+		fprintf(stderr, "file open error %s: %s\n", cfg.cdev,
+			strerror(errno));
+		return -1;
+	}
+	if (framed) {
+		uint32_t on = 1;
+
+		if (ioctl(fd, DUMMY_SET_RX_FRAMED, &on)) {
+			fprintf(stderr, "DUMMY_SET_RX_FRAMED: %s\n",
+				strerror(errno));
+			close(fd);
+			return -1;
+		}
+	}
+	return fd;
+}
+
+static int usage(char **argv)
+{
+	printf("Usage: %s [options]\n", argv[0]);
+	printf("  -d <n>     device index, /dev/dummy/dummy<n> (0)\n");
+	printf("  -r <n>     reader threads (1)\n");
+	printf("  -w <n>     writer threads (1)\n");
+	printf("  -s <bytes> frame size, %zu..%d (1024)\n",
+	       sizeof(struct dummy_emu_hdr), MAX_FRAME);
+	printf("  -i <us>    set the poll interval first (device default)\n");
+	printf("  -m <mode>  block, nonblock or poll (block)\n");
+	printf("  -t <s>     run time in seconds (5)\n");
+	printf("  -j         JSON output\n");
+	return -1;
+}
+
+static int parse_args(int argc, char **argv)
+{
+	int opt, i;
+
+	snprintf(cfg.cdev, sizeof(cfg.cdev), "/dev/dummy/dummy0");
+	while ((opt = getopt(argc, argv, "d:r:w:s:i:m:t:j")) != -1) {
+		switch (opt) {
+		case 'd':
+			snprintf(cfg.cdev, sizeof(cfg.cdev),
+				 "/dev/dummy/dummy%d", atoi(optarg));
+			break;
+		case 'r':
+			cfg.readers = atoi(optarg);
+			break;
+		case 'w':
+			cfg.writers = atoi(optarg);
+			break;
+		case 's':
+			cfg.frame_size = atoi(optarg);
+			break;
+		case 'i':
+			cfg.interval_us = atoi(optarg);
+			break;
+		case 'm':
+			for (i = 0; i <= MODE_POLL; i++)
+				if (!strcmp(optarg, mode_names[i]))
+					break;
+			if (i > MODE_POLL)
+				return usage(argv);
+			cfg.mode = i;
+			break;
+		case 't':
+			cfg.seconds = atoi(optarg);
+			break;
+		case 'j':
+			cfg.json = 1;
+			break;
+		default:
+			return usage(argv);
+		}
+	}
+
+	if (cfg.readers < 0 || cfg.writers < 0 || !(cfg.readers + cfg.writers) ||
+	    cfg.readers + cfg.writers > MAX_THREADS || cfg.seconds <= 0 ||
+	    cfg.frame_size < sizeof(struct dummy_emu_hdr) ||
+	    cfg.frame_size > MAX_FRAME)
+		return usage(argv);
+	return 0;
+}
+
+static void report(struct bench_thread *th, double secs,
+		   const struct dummy_stats *ks)
+{
+	uint64_t rx_frames = 0, rx_bytes = 0, tx_frames = 0, tx_bytes = 0;
+	uint64_t nr_lat = 0, *lat, *p, lost, out_of_order = 0;
+	int i;
+
+	for (i = 0; i < cfg.readers; i++) {
+		rx_frames += th[i].frames;
+		rx_bytes += th[i].bytes;
+		nr_lat += th[i].nr_lat;
+		out_of_order += th[i].out_of_order;
+	}
+	lost = seq_lost(th);
+	for (; i < cfg.readers + cfg.writers; i++) {
+		tx_frames += th[i].frames;
+		tx_bytes += th[i].bytes;
+	}
+
+	lat = p = malloc((nr_lat ? nr_lat : 1) * sizeof(*lat));
+	if (!lat)
+		nr_lat = 0;
+	for (i = 0; lat && i < cfg.readers; i++) {
+		memcpy(p, th[i].lat, th[i].nr_lat * sizeof(*lat));
+		p += th[i].nr_lat;
+	}
+	qsort(lat, nr_lat, sizeof(*lat), cmp_u64);
+
+	if (cfg.json) {
+		printf("{\"device\":\"%s\",\"mode\":\"%s\",\"readers\":%d,"
+		       "\"writers\":%d,\"frame_size\":%u,\"interval_us\":%u,"
+		       "\"seconds\":%.3f,\n", cfg.cdev, mode_names[cfg.mode],
+		       cfg.readers, cfg.writers, cfg.frame_size, cfg.interval_us,
+		       secs);
+		printf(" \"rx\":{\"frames\":%llu,\"bytes\":%llu,\"fps\":%.0f,"
+		       "\"mbps\":%.3f},\n", (unsigned long long)rx_frames,
+		       (unsigned long long)rx_bytes, rx_frames / secs,
+		       rx_bytes / secs / 1e6);
+		printf(" \"tx\":{\"frames\":%llu,\"bytes\":%llu,\"fps\":%.0f,"
+		       "\"mbps\":%.3f},\n", (unsigned long long)tx_frames,
+		       (unsigned long long)tx_bytes, tx_frames / secs,
+		       tx_bytes / secs / 1e6);
+		printf(" \"latency_ns\":{\"samples\":%llu,\"p50\":%llu,"
+		       "\"p99\":%llu,\"p999\":%llu,\"max\":%llu},\n",
+		       (unsigned long long)nr_lat,
+		       (unsigned long long)percentile(lat, nr_lat, 0.50),
+		       (unsigned long long)percentile(lat, nr_lat, 0.99),
+		       (unsigned long long)percentile(lat, nr_lat, 0.999),
+		       (unsigned long long)(nr_lat ? lat[nr_lat - 1] : 0));
+		printf(" \"seq\":{\"lost\":%llu,\"out_of_order\":%llu},\n",
+		       (unsigned long long)lost, (unsigned long long)out_of_order);
+		printf(" \"driver\":{\"rx_overruns\":%llu,\"rx_dropped\":%llu,"
+		       "\"empty_polls\":%llu,\"poll_cycles\":%llu,"
+		       "\"reader_sleeps\":%llu,\"writer_sleeps\":%llu}}\n",
+		       (unsigned long long)ks->rx_overruns,
+		       (unsigned long long)ks->rx_dropped,
+		       (unsigned long long)ks->empty_polls,
+		       (unsigned long long)ks->poll_cycles,
+		       (unsigned long long)ks->reader_sleeps,
+		       (unsigned long long)ks->writer_sleeps);
+	} else {
+		printf("%s %s, %d readers, %d writers, %u byte frames, %.1f s\n",
+		       cfg.cdev, mode_names[cfg.mode], cfg.readers, cfg.writers,
+		       cfg.frame_size, secs);
+		printf("rx: %llu frames, %.0f frames/s, %.3f MB/s\n",
+		       (unsigned long long)rx_frames, rx_frames / secs,
+		       rx_bytes / secs / 1e6);
+		printf("tx: %llu frames, %.0f frames/s, %.3f MB/s\n",
+		       (unsigned long long)tx_frames, tx_frames / secs,
+		       tx_bytes / secs / 1e6);
+		printf("latency (%llu samples): p50 %llu ns, p99 %llu ns, p999 %llu ns\n",
+		       (unsigned long long)nr_lat,
+		       (unsigned long long)percentile(lat, nr_lat, 0.50),
+		       (unsigned long long)percentile(lat, nr_lat, 0.99),
+		       (unsigned long long)percentile(lat, nr_lat, 0.999));
+		printf("seq: %llu lost, %llu out of order\n",
+		       (unsigned long long)lost, (unsigned long long)out_of_order);
+		printf("driver: %llu overruns, %llu bytes dropped, %llu/%llu empty polls\n",
+		       (unsigned long long)ks->rx_overruns,
+		       (unsigned long long)ks->rx_dropped,
+		       (unsigned long long)ks->empty_polls,
+		       (unsigned long long)ks->poll_cycles);
+	}
+	free(lat);
+}
+
+int main(int argc, char **argv)
+{
+	struct bench_thread th[MAX_THREADS] = { 0 };
+	struct dummy_stats ks0 = { 0 }, ks1 = { 0 };
+	struct sigaction sa = { .sa_handler = on_signal };
+	uint64_t t0, t1;
+	int i, n, started, err, ctl, ret = 0;
+
+	if (parse_args(argc, argv))
+		return -1;
+
+	/* no SA_RESTART: blocked read()/write() return EINTR at the end */
+	sigaction(SIGUSR1, &sa, NULL);
+
+	ctl = open_dev(0);
+	if (ctl < 0)
+		return -1;
+	if (cfg.interval_us &&
+	    ioctl(ctl, DUMMY_SET_POOLING_US, &cfg.interval_us)) {
+		fprintf(stderr, "DUMMY_SET_POOLING_US: %s\n", strerror(errno));
+		return -1;
+	}
+
+	n = cfg.readers + cfg.writers;
+	for (i = 0; i < n; i++) {
+		th[i].id = i;
+		th[i].fd = open_dev(i < cfg.readers);
+		if (th[i].fd < 0)
+			return -1;
+	}
+
+	if (ioctl(ctl, DUMMY_GET_STATS, &ks0)) {
+		fprintf(stderr, "DUMMY_GET_STATS: %s\n", strerror(errno));
+		return -1;
+	}
+	t0 = now_ns();
+	for (started = 0; started < n; started++) {
+		err = pthread_create(&th[started].tid, NULL,
+				     started < cfg.readers ? reader : writer,
+				     &th[started]);
+		if (err) {
+			fprintf(stderr, "pthread_create: %s\n", strerror(err));
+			ret = -1;
+			break;
+		}
+	}
+
+	/* on failure only collect the ones already running */
+	if (!ret)
+		sleep(cfg.seconds);
+	stop = 1;
+	for (i = 0; i < started; i++) {
+		/* it may have been on its way into a blocking call */
+		while (pthread_tryjoin_np(th[i].tid, NULL) == EBUSY) {
+			pthread_kill(th[i].tid, SIGUSR1);
+			usleep(10000);
+		}
+		if (th[i].err) {
+			fprintf(stderr, "thread %d: %s\n", i, strerror(th[i].err));
+			ret = -1;
+		}
+	}
+	t1 = now_ns();
+	if (ioctl(ctl, DUMMY_GET_STATS, &ks1)) {
+		fprintf(stderr, "DUMMY_GET_STATS: %s\n", strerror(errno));
+		ret = -1;
+	}
+	if (ret)
+		goto out;
+
+	/* driver counters of this run only */
+	ks1.rx_overruns -= ks0.rx_overruns;
+	ks1.rx_dropped -= ks0.rx_dropped;
+	ks1.empty_polls -= ks0.empty_polls;
+	ks1.poll_cycles -= ks0.poll_cycles;
+	ks1.reader_sleeps -= ks0.reader_sleeps;
+	ks1.writer_sleeps -= ks0.writer_sleeps;
+	report(th, (t1 - t0) / 1e9, &ks1);
+
+out:
+	for (i = 0; i < n; i++) {
+		free(th[i].lat);
+		free(th[i].seq);
+		close(th[i].fd);
+	}
+	close(ctl);
+	return ret;
+}
@@ -6,6 +6,10 @@
 #include <linux/cdev.h>
 #include <linux/device.h>
 #include <linux/mutex.h>
+#include <linux/poll.h>
+#include <linux/hrtimer.h>
+#include <linux/kthread.h>
+#include <linux/slab.h>
 
 #include <asm/uaccess.h>
 
@@ -20,40 +24,94 @@ struct my_dummy_cdev {
 	atomic_t num_open;
 };
 
+/*Per open file state*/
+struct my_dummy_file {
+	struct my_dummy_cdev *cdevice;
+	bool framed;		/* read() returns one record per call */
+	bool broadcast;		/* read() goes through reader */
+	struct plat_dummy_reader reader;
+};
+
 struct class *dummy_class;
 
-struct my_dummy_cdev dummy_cdevs[DUMMY_DEVICES];
+static struct my_dummy_cdev *dummy_cdevs;
+static int dummy_ncdevs;	/* minor == platform device index */
 
-ssize_t dummy_cdev_read(struct file *filp, char __user *buf, size_t count,
-			loff_t *f_pos)
+/*read()/readv() and aio/io_uring requests all come through the iter ops*/
+static bool dummy_cdev_nonblock(struct kiocb *iocb)
 {
-	struct my_dummy_cdev *cdevice = filp->private_data;
+	return (iocb->ki_filp->f_flags & O_NONBLOCK) ||
+	       (iocb->ki_flags & IOCB_NOWAIT);
+}
 
-	if (filp->f_flags & O_NONBLOCK)
-		return -EAGAIN;
+ssize_t dummy_cdev_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct my_dummy_file *dfile = iocb->ki_filp->private_data;
+	struct my_dummy_cdev *cdevice = dfile->cdevice;
+
+	if (!iov_iter_count(to))
+		return 0;
+
+	if (READ_ONCE(dfile->broadcast)) {
+		if (cdevice->my_device && cdevice->my_device->read_reader)
+			return cdevice->my_device->read_reader(cdevice->my_device,
+							       &dfile->reader, to,
+							       dummy_cdev_nonblock(iocb));
+		return -1;
+	}
+
+	if (dfile->framed) {
+		if (cdevice->my_device && cdevice->my_device->dummy_read_frame)
+			return cdevice->my_device->dummy_read_frame(cdevice->my_device,
+								    to,
+								    dummy_cdev_nonblock(iocb));
+		return -1;
+	}
 
 	if (cdevice->my_device && cdevice->my_device->dummy_read)
-		return cdevice->my_device->dummy_read(cdevice->my_device, buf,
-						      count);
+		return cdevice->my_device->dummy_read(cdevice->my_device, to,
+						      dummy_cdev_nonblock(iocb));
 	return -1;
 }
 
-ssize_t dummy_cdev_write(struct file *filp, const char __user *buf,
-			 size_t count, loff_t *f_pos)
+ssize_t dummy_cdev_write_iter(struct kiocb *iocb, struct iov_iter *from)
 {
-	struct my_dummy_cdev *cdevice = filp->private_data;
+	struct my_dummy_file *dfile = iocb->ki_filp->private_data;
+	struct my_dummy_cdev *cdevice = dfile->cdevice;
 	ssize_t bytes_written = 0;
 
+	if (!iov_iter_count(from))
+		return 0;
+
 	bytes_written = cdevice->my_device->dummy_write(cdevice->my_device,
-							     buf, count);
+							     from,
+							     dummy_cdev_nonblock(iocb));
 	return bytes_written;
 }
 
-#define MAX_OPEN 2
+static unsigned int dummy_cdev_poll(struct file *filp, poll_table *wait)
+{
+	struct my_dummy_file *dfile = filp->private_data;
+	struct my_dummy_cdev *cdevice = dfile->cdevice;
+
+	if (READ_ONCE(dfile->broadcast) && cdevice->my_device &&
+	    cdevice->my_device->poll_reader)
+		return cdevice->my_device->poll_reader(cdevice->my_device,
+						       &dfile->reader, filp,
+						       wait);
+
+	if (cdevice->my_device && cdevice->my_device->dummy_poll)
+		return cdevice->my_device->dummy_poll(cdevice->my_device, filp,
+						      wait);
+	return POLLERR;
+}
+
+#define MAX_OPEN 8 /*e.g. a recorder and a live consumer in broadcast mode*/
 
 static int dummy_cdev_open(struct inode *inode, struct file *filp)
 {
 	struct my_dummy_cdev *cdevice;
+	struct my_dummy_file *dfile;
 	const int minor = iminor(inode);
 
 	pr_info("++%s(%d) point 1\n", __func__, minor);
@@ -63,7 +121,14 @@ static int dummy_cdev_open(struct inode *inode, struct file *filp)
 		atomic_dec(&cdevice->num_open);
 		return -ENODEV;
 	}
-	filp->private_data = cdevice;
+	dfile = kzalloc(sizeof(*dfile), GFP_KERNEL);
+	if (!dfile) {
+		atomic_dec(&cdevice->num_open);
+		return -ENOMEM;
+	}
+	dfile->cdevice = cdevice;
+	INIT_LIST_HEAD(&dfile->reader.node);
+	filp->private_data = dfile;
 	pr_info("++%s(%d) point 2 \n", __func__, minor);
 
 	return nonseekable_open(inode, filp);
@@ -77,10 +142,15 @@ static int dummy_cdev_open(struct inode *inode, struct file *filp)
 static int dummy_cdev_release(struct inode *inode, struct file *filp)
 {
 	struct my_dummy_cdev *cdevice;
+	struct my_dummy_file *dfile = filp->private_data;
 	const int minor= iminor(inode);
 
 	cdevice = container_of(inode->i_cdev, struct my_dummy_cdev, cdev);
 	pr_info("++%s(%d)\n", __func__, minor);
+	if (cdevice->my_device && cdevice->my_device->rx_unsubscribe)
+		cdevice->my_device->rx_unsubscribe(cdevice->my_device,
+						   &dfile->reader);
+	kfree(dfile);
 	atomic_dec(&cdevice->num_open);
 
 	return 0;
@@ -90,7 +160,18 @@ long dummy_cdev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
 	int err = 0;
 	u32 interval;
-	struct my_dummy_cdev *cdevice = filp->private_data;
+	u64 overruns;
+	struct dummy_backoff backoff;
+	struct dummy_tx_stats tx_stats;
+	struct dummy_recv_frames recv;
+	struct dummy_recv_frames_ts recv_ts;
+	struct dummy_rx_drops drops;
+	struct dummy_stats stats;
+	struct dummy_poll_thread thread;
+	struct dummy_tx_coalesce coalesce;
+	struct dummy_reader_lag lag;
+	struct my_dummy_file *dfile = filp->private_data;
+	struct my_dummy_cdev *cdevice = dfile->cdevice;
 
 	/* don't even decode wrong cmds: better
 	 * returning  ENOTTY than EFAULT */
@@ -127,6 +208,372 @@ long dummy_cdev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 			}
 			break;
 
+		case DUMMY_RX_ADVANCE:
+			if (cdevice->my_device &&
+			    cdevice->my_device->rx_advance) {
+
+				err = __get_user(interval, (u32 __user *)arg);
+				if (err)
+					break;
+
+				err = cdevice->my_device->rx_advance(cdevice->my_device,
+								     interval);
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_INJECT_IRQ:
+			if (cdevice->my_device &&
+			    cdevice->my_device->inject_irq)
+				err = cdevice->my_device->inject_irq(cdevice->my_device);
+			else
+				err = -EINVAL;
+			break;
+
+		case DUMMY_SET_POOLING_US:
+			if (cdevice->my_device &&
+			    cdevice->my_device->set_poll_interval_us) {
+
+				err = __get_user(interval, (u32 __user *)arg);
+				if (err)
+					break;
+
+				err = cdevice->my_device->set_poll_interval_us(cdevice->my_device,
+									       interval);
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_GET_POLL_OVERRUNS:
+			if (cdevice->my_device &&
+			    cdevice->my_device->get_poll_overruns) {
+
+				err = cdevice->my_device->get_poll_overruns(cdevice->my_device,
+									    &overruns);
+				if (err)
+					break;
+
+				err = __put_user(overruns, (u64 __user *)arg);
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_SET_POLL_BACKOFF:
+			if (cdevice->my_device &&
+			    cdevice->my_device->set_poll_backoff) {
+
+				if (copy_from_user(&backoff, (void __user *)arg,
+						   sizeof(backoff))) {
+					err = -EFAULT;
+					break;
+				}
+
+				err = cdevice->my_device->set_poll_backoff(cdevice->my_device,
+									   &backoff);
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_GET_POOLING_US:
+			if (cdevice->my_device &&
+			    cdevice->my_device->get_poll_interval_us) {
+
+				err = cdevice->my_device->get_poll_interval_us(cdevice->my_device,
+									       &interval);
+				if (err)
+					break;
+
+				err = __put_user(interval, (u32 __user *)arg);
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_GET_TX_STATS:
+			if (cdevice->my_device &&
+			    cdevice->my_device->get_tx_stats) {
+
+				err = cdevice->my_device->get_tx_stats(cdevice->my_device,
+								       &tx_stats);
+				if (err)
+					break;
+
+				if (copy_to_user((void __user *)arg, &tx_stats,
+						 sizeof(tx_stats)))
+					err = -EFAULT;
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_SET_RX_FRAMED:
+			err = __get_user(interval, (u32 __user *)arg);
+			if (err)
+				break;
+
+			mutex_lock(&cdevice->mutex);
+			if (dfile->broadcast)
+				err = -EINVAL;
+			else
+				dfile->framed = !!interval;
+			mutex_unlock(&cdevice->mutex);
+			break;
+
+		case DUMMY_RECV_FRAMES:
+			if (cdevice->my_device &&
+			    cdevice->my_device->recv_frames) {
+
+				if (copy_from_user(&recv, (void __user *)arg,
+						   sizeof(recv))) {
+					err = -EFAULT;
+					break;
+				}
+
+				err = cdevice->my_device->recv_frames(cdevice->my_device,
+								      &recv, 0,
+								      filp->f_flags & O_NONBLOCK);
+				if (err)
+					break;
+
+				err = __put_user(recv.nr,
+						 &((struct dummy_recv_frames __user *)arg)->nr);
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_RECV_FRAMES_TS:
+			if (cdevice->my_device &&
+			    cdevice->my_device->recv_frames) {
+
+				if (copy_from_user(&recv_ts, (void __user *)arg,
+						   sizeof(recv_ts))) {
+					err = -EFAULT;
+					break;
+				}
+
+				if (!recv_ts.ts) {
+					err = -EINVAL;
+					break;
+				}
+
+				err = cdevice->my_device->recv_frames(cdevice->my_device,
+								      &recv_ts.frames,
+								      recv_ts.ts,
+								      filp->f_flags & O_NONBLOCK);
+				if (err)
+					break;
+
+				err = __put_user(recv_ts.frames.nr,
+						 &((struct dummy_recv_frames_ts __user *)arg)->frames.nr);
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_SET_TS_CLOCK:
+			if (cdevice->my_device &&
+			    cdevice->my_device->set_ts_clock) {
+
+				err = __get_user(interval, (u32 __user *)arg);
+				if (err)
+					break;
+
+				err = cdevice->my_device->set_ts_clock(cdevice->my_device,
+								       interval);
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_SET_RX_RING_SIZE:
+			if (cdevice->my_device &&
+			    cdevice->my_device->set_rx_ring_size) {
+
+				err = __get_user(interval, (u32 __user *)arg);
+				if (err)
+					break;
+
+				/* nobody else may be using the ring */
+				if (atomic_read(&cdevice->num_open) > 1) {
+					err = -EBUSY;
+					break;
+				}
+
+				err = cdevice->my_device->set_rx_ring_size(cdevice->my_device,
+									   interval);
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_SET_RX_POLICY:
+			if (cdevice->my_device &&
+			    cdevice->my_device->set_rx_policy) {
+
+				err = __get_user(interval, (u32 __user *)arg);
+				if (err)
+					break;
+
+				err = cdevice->my_device->set_rx_policy(cdevice->my_device,
+									interval);
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_GET_RX_DROPS:
+			if (cdevice->my_device &&
+			    cdevice->my_device->get_rx_drops) {
+
+				err = cdevice->my_device->get_rx_drops(cdevice->my_device,
+								       &drops);
+				if (err)
+					break;
+
+				if (copy_to_user((void __user *)arg, &drops,
+						 sizeof(drops)))
+					err = -EFAULT;
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_GET_STATS:
+			if (cdevice->my_device &&
+			    cdevice->my_device->get_stats) {
+
+				err = cdevice->my_device->get_stats(cdevice->my_device,
+								    &stats);
+				if (err)
+					break;
+
+				if (copy_to_user((void __user *)arg, &stats,
+						 sizeof(stats)))
+					err = -EFAULT;
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_SET_POLL_THREAD:
+			if (cdevice->my_device &&
+			    cdevice->my_device->set_poll_thread) {
+
+				if (copy_from_user(&thread, (void __user *)arg,
+						   sizeof(thread))) {
+					err = -EFAULT;
+					break;
+				}
+
+				err = cdevice->my_device->set_poll_thread(cdevice->my_device,
+									  &thread);
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_SET_TX_COALESCE:
+			if (cdevice->my_device &&
+			    cdevice->my_device->set_tx_coalesce) {
+
+				if (copy_from_user(&coalesce, (void __user *)arg,
+						   sizeof(coalesce))) {
+					err = -EFAULT;
+					break;
+				}
+
+				err = cdevice->my_device->set_tx_coalesce(cdevice->my_device,
+									  &coalesce);
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_TX_FLUSH:
+			if (cdevice->my_device && cdevice->my_device->tx_flush)
+				err = cdevice->my_device->tx_flush(cdevice->my_device,
+								   false);
+			else
+				err = -EINVAL;
+			break;
+
+		case DUMMY_TX_DOORBELL:
+			if (cdevice->my_device && cdevice->my_device->tx_doorbell)
+				err = cdevice->my_device->tx_doorbell(cdevice->my_device);
+			else
+				err = -EINVAL;
+			break;
+
+		case DUMMY_RX_SUBSCRIBE:
+			if (cdevice->my_device &&
+			    cdevice->my_device->rx_subscribe) {
+
+				err = __get_user(interval, (u32 __user *)arg);
+				if (err)
+					break;
+
+				mutex_lock(&cdevice->mutex);
+				if (dfile->framed) {
+					err = -EINVAL;
+				} else if (interval) {
+					err = cdevice->my_device->rx_subscribe(cdevice->my_device,
+									       &dfile->reader);
+					if (!err)
+						WRITE_ONCE(dfile->broadcast, true);
+				} else {
+					WRITE_ONCE(dfile->broadcast, false);
+					cdevice->my_device->rx_unsubscribe(cdevice->my_device,
+									   &dfile->reader);
+				}
+				mutex_unlock(&cdevice->mutex);
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_GET_READER_LAG:
+			if (cdevice->my_device &&
+			    cdevice->my_device->get_reader_lag) {
+
+				if (!READ_ONCE(dfile->broadcast)) {
+					err = -EINVAL;
+					break;
+				}
+
+				err = cdevice->my_device->get_reader_lag(cdevice->my_device,
+									 &dfile->reader,
+									 &lag);
+				if (err)
+					break;
+
+				if (copy_to_user((void __user *)arg, &lag,
+						 sizeof(lag)))
+					err = -EFAULT;
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
+		case DUMMY_SET_RX_EVICT:
+			if (cdevice->my_device &&
+			    cdevice->my_device->set_rx_evict) {
+
+				err = __get_user(interval, (u32 __user *)arg);
+				if (err)
+					break;
+
+				err = cdevice->my_device->set_rx_evict(cdevice->my_device,
+								       interval);
+			} else {
+				err = -EINVAL;
+			}
+			break;
+
 		default:  /* redundant, as cmd was checked against MAXNR */
 			return -ENOTTY;
 	}
@@ -134,6 +581,106 @@ long dummy_cdev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 	return err;
 }
 
+static int dummy_cdev_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct my_dummy_file *dfile = filp->private_data;
+	struct my_dummy_cdev *cdevice = dfile->cdevice;
+
+	if (cdevice->my_device && cdevice->my_device->dummy_mmap)
+		return cdevice->my_device->dummy_mmap(cdevice->my_device, vma);
+	return -ENODEV;
+}
+
+/*Sends coalesced writes and waits until the device took them*/
+static int dummy_cdev_fsync(struct file *filp, loff_t start, loff_t end,
+			    int datasync)
+{
+	struct my_dummy_file *dfile = filp->private_data;
+	struct my_dummy_cdev *cdevice = dfile->cdevice;
+
+	if (cdevice->my_device && cdevice->my_device->tx_flush)
+		return cdevice->my_device->tx_flush(cdevice->my_device, true);
+	return -EINVAL;
+}
+
+/*One read-only sysfs file per struct dummy_stats field*/
+struct dummy_stat_attr {
+	struct device_attribute attr;
+	size_t offset;
+};
+
+static ssize_t dummy_stat_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct my_dummy_cdev *cdevice = dev_get_drvdata(dev);
+	struct dummy_stat_attr *sattr =
+		container_of(attr, struct dummy_stat_attr, attr);
+	struct dummy_stats stats;
+	int err;
+
+	if (!cdevice->my_device || !cdevice->my_device->get_stats)
+		return -ENODEV;
+
+	err = cdevice->my_device->get_stats(cdevice->my_device, &stats);
+	if (err)
+		return err;
+
+	return sprintf(buf, "%llu\n",
+		       *(u64 *)((char *)&stats + sattr->offset));
+}
+
+#define DUMMY_STAT_ATTR(_name)						\
+	static struct dummy_stat_attr dummy_stat_##_name = {		\
+		.attr = __ATTR(_name, 0444, dummy_stat_show, NULL),	\
+		.offset = offsetof(struct dummy_stats, _name),		\
+	}
+
+DUMMY_STAT_ATTR(rx_bytes);
+DUMMY_STAT_ATTR(rx_frames);
+DUMMY_STAT_ATTR(tx_bytes);
+DUMMY_STAT_ATTR(tx_frames);
+DUMMY_STAT_ATTR(poll_cycles);
+DUMMY_STAT_ATTR(empty_polls);
+DUMMY_STAT_ATTR(ring_hwm);
+DUMMY_STAT_ATTR(rx_overruns);
+DUMMY_STAT_ATTR(rx_dropped);
+DUMMY_STAT_ATTR(reader_sleeps);
+DUMMY_STAT_ATTR(writer_sleeps);
+DUMMY_STAT_ATTR(rd_contended);
+DUMMY_STAT_ATTR(wr_contended);
+DUMMY_STAT_ATTR(timer_overruns);
+DUMMY_STAT_ATTR(rx_xfer_cycles);
+DUMMY_STAT_ATTR(tx_xfer_cycles);
+
+static struct attribute *dummy_stat_attrs[] = {
+	&dummy_stat_rx_bytes.attr.attr,
+	&dummy_stat_rx_frames.attr.attr,
+	&dummy_stat_tx_bytes.attr.attr,
+	&dummy_stat_tx_frames.attr.attr,
+	&dummy_stat_poll_cycles.attr.attr,
+	&dummy_stat_empty_polls.attr.attr,
+	&dummy_stat_ring_hwm.attr.attr,
+	&dummy_stat_rx_overruns.attr.attr,
+	&dummy_stat_rx_dropped.attr.attr,
+	&dummy_stat_reader_sleeps.attr.attr,
+	&dummy_stat_writer_sleeps.attr.attr,
+	&dummy_stat_rd_contended.attr.attr,
+	&dummy_stat_wr_contended.attr.attr,
+	&dummy_stat_timer_overruns.attr.attr,
+	&dummy_stat_rx_xfer_cycles.attr.attr,
+	&dummy_stat_tx_xfer_cycles.attr.attr,
+	NULL,
+};
+
+static const struct attribute_group dummy_stat_group = {
+	.name	= "stats",
+	.attrs	= dummy_stat_attrs,
+};
+
+static const struct attribute_group *dummy_cdev_groups[] = {
+	&dummy_stat_group,
+	NULL,
+};
 
 static char *dummy_cdev_node(struct device *dev, umode_t *mode)
 {
@@ -141,48 +688,73 @@ static char *dummy_cdev_node(struct device *dev, umode_t *mode)
 }
 
 static const struct file_operations dummy_cdev_fops = {
-	.read	= dummy_cdev_read,
-	.write	= dummy_cdev_write,
+	.read_iter	= dummy_cdev_read_iter,
+	.write_iter	= dummy_cdev_write_iter,
+	/* splice()/sendfile() go through the iter ops above */
+	.splice_read	= generic_file_splice_read,
+	.splice_write	= iter_file_splice_write,
+	.poll	= dummy_cdev_poll,
 	.open	= dummy_cdev_open,
 	.release	= dummy_cdev_release,
 	.unlocked_ioctl = dummy_cdev_ioctl,
+	.mmap		= dummy_cdev_mmap,
+	.fsync		= dummy_cdev_fsync,
 	.owner		= THIS_MODULE,
 };
 
 
 int dummy_major = 0; /*Just for info*/
 
+/*cdevs below n were added*/
+static void dummy_cdev_del(int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (dummy_cdevs[i].my_device)
+			cdev_del(&dummy_cdevs[i].cdev);
+}
+
 static int __init dummy_cdev_init(void)
 {
 	dev_t dev = 0;
-	int ret, i, devnum, minor = 0;
+	int ret, i, devnum;
+
+	dummy_ncdevs = get_dummy_platform_device_count();
+	if (!dummy_ncdevs) {
+		pr_err("no dummy platform devices\n");
+		return -ENODEV;
+	}
+
+	dummy_cdevs = kcalloc(dummy_ncdevs, sizeof(*dummy_cdevs), GFP_KERNEL);
+	if (!dummy_cdevs)
+		return -ENOMEM;
 
 	if (dummy_major) {
 		dev = MKDEV(dummy_major, 0);
-		ret = register_chrdev_region(dev, DUMMY_DEVICES, "dummy_cdevs");
+		ret = register_chrdev_region(dev, dummy_ncdevs, "dummy_cdevs");
 	} else {
-		ret = alloc_chrdev_region(&dev, 0, DUMMY_DEVICES, "dummy_cdevs");
+		ret = alloc_chrdev_region(&dev, 0, dummy_ncdevs, "dummy_cdevs");
 		dummy_major = MAJOR(dev);
 	}
 
 	if (ret < 0)
-		return ret;
+		goto error_free;
 
-	/* Initialize each device. */
-	for (i = 0; i < DUMMY_DEVICES; i++) {
+	/* Initialize each device, indexes of removed devices stay unused */
+	for (i = 0; i < dummy_ncdevs; i++) {
 		dummy_cdevs[i].dummy_major = dummy_major;
 		mutex_init(&dummy_cdevs[i].mutex);
 		dummy_cdevs[i].my_device = get_dummy_platform_device(i);
-		if (!dummy_cdevs[i].my_device) {
-			pr_err("can't get device%d\n", i);
-			goto error_region;
-		}
+		if (!dummy_cdevs[i].my_device)
+			continue;
 		devnum = MKDEV(dummy_major, i);
 		cdev_init(&dummy_cdevs[i].cdev, &dummy_cdev_fops);
 		ret = cdev_add (&dummy_cdevs[i].cdev, devnum, 1);
 		/* Fail gracefully if need be */
 		if (ret) {
-			pr_err( "Error %d adding scull%d", ret, i);
+			pr_err( "Error %d adding dummy%d", ret, i);
+			dummy_cdev_del(i);
 			goto error_region;
 		}
 	}
@@ -190,35 +762,40 @@ static int __init dummy_cdev_init(void)
 	dummy_class = class_create(THIS_MODULE, "dummy");
 	if (IS_ERR(dummy_class)) {
 		pr_err("Error creating dummy class.\n");
-		cdev_del(&dummy_cdevs[0].cdev);
-		cdev_del(&dummy_cdevs[1].cdev);
+		dummy_cdev_del(dummy_ncdevs);
 		ret = PTR_ERR(dummy_class);
 		goto error_region;
 	}
 
 	dummy_class->devnode = dummy_cdev_node;
-	device_create(dummy_class, NULL, MKDEV(dummy_major, 0), NULL,
-		      "dummy" "%d", minor++);
-	device_create(dummy_class, NULL, MKDEV(dummy_major, 1), NULL,
-		      "dummy" "%d", minor);
+	for (i = 0; i < dummy_ncdevs; i++) {
+		if (!dummy_cdevs[i].my_device)
+			continue;
+		device_create_with_groups(dummy_class, NULL,
+					  MKDEV(dummy_major, i), &dummy_cdevs[i],
+					  dummy_cdev_groups, "dummy" "%d", i);
+	}
 	return 0;
 
 error_region:
-	unregister_chrdev_region(dev, DUMMY_DEVICES);
+	unregister_chrdev_region(dev, dummy_ncdevs);
+error_free:
+	kfree(dummy_cdevs);
 	return ret;
 }
 
 static void __exit dummy_cdev_exit(void)
 {
 	int i;
-	device_destroy(dummy_class, MKDEV(dummy_major, 0));
-	device_destroy(dummy_class, MKDEV(dummy_major, 1));
+
+	for (i = 0; i < dummy_ncdevs; i++)
+		if (dummy_cdevs[i].my_device)
+			device_destroy(dummy_class, MKDEV(dummy_major, i));
 	class_destroy(dummy_class);
 
-	for (i = 0; i < DUMMY_DEVICES; i++) {
-		cdev_del(&dummy_cdevs[i].cdev);
-	}
-	unregister_chrdev_region(MKDEV(dummy_major, 0), DUMMY_DEVICES);
+	dummy_cdev_del(dummy_ncdevs);
+	unregister_chrdev_region(MKDEV(dummy_major, 0), dummy_ncdevs);
+	kfree(dummy_cdevs);
 }
 
 module_init(dummy_cdev_init);
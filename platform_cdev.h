@@ -4,8 +4,235 @@
 #include <linux/types.h>
 
 #define DUMMY_IOC_MAGIC 'V'
-#define DUMMY_IOC_MAXNR 0x01
+#define DUMMY_IOC_MAXNR 0x17
 
 #define DUMMY_SET_POOLING _IOW(DUMMY_IOC_MAGIC, 0x01, uint32_t)
+#define DUMMY_RX_ADVANCE _IOW(DUMMY_IOC_MAGIC, 0x02, uint32_t)
+#define DUMMY_INJECT_IRQ _IO(DUMMY_IOC_MAGIC, 0x03)
+/*hrtimer driven polling, interval in us (50 ~ 10000000)*/
+#define DUMMY_SET_POOLING_US _IOW(DUMMY_IOC_MAGIC, 0x04, uint32_t)
+#define DUMMY_GET_POLL_OVERRUNS _IOR(DUMMY_IOC_MAGIC, 0x05, uint64_t)
+
+/*Idle backoff of the jiffies poller: interval is multiplied by factor on
+ * every idle pass up to max_ms and drops to min_ms on traffic.
+ * factor 1 - fixed interval.
+ * */
+struct dummy_backoff {
+	uint32_t min_ms;
+	uint32_t max_ms;
+	uint32_t factor;
+};
+
+#define DUMMY_SET_POLL_BACKOFF _IOW(DUMMY_IOC_MAGIC, 0x06, struct dummy_backoff)
+/*Interval in use right now, in us. 0 - interrupt driven*/
+#define DUMMY_GET_POOLING_US _IOR(DUMMY_IOC_MAGIC, 0x07, uint32_t)
+
+struct dummy_tx_stats {
+	uint32_t slots;		/* TX queue length */
+	uint32_t depth;		/* frames queued now */
+	uint32_t depth_max;	/* the most frames ever queued */
+	uint32_t reserved;
+	uint64_t frames;	/* frames sent to device */
+	uint64_t stalls;	/* writes blocked on a full queue */
+	uint64_t stall_ns;	/* total time writers were blocked */
+};
+
+#define DUMMY_GET_TX_STATS _IOR(DUMMY_IOC_MAGIC, 0x08, struct dummy_tx_stats)
+
+/*Framed RX: every device transfer is a record. With DUMMY_SET_RX_FRAMED 1
+ * read() on this fd returns one record per call, a record longer than
+ * the buffer is truncated. DUMMY_RECV_FRAMES gets a batch of records.
+ * Boundaries are kept for the last 255 records only; a framed reader
+ * further behind loses the older ones, seen as a gap in seq.
+ * */
+#define DUMMY_FRAME_TRUNC	(1 << 0) /* record didn't fit in buf */
+
+struct dummy_frame_desc {
+	uint32_t seq;		/* record number, gaps mean lost records */
+	uint32_t len;		/* bytes stored in buf */
+	uint32_t offset;	/* record start in buf */
+	uint32_t flags;
+};
+
+struct dummy_recv_frames {
+	uint64_t descs;		/* struct dummy_frame_desc [nr] */
+	uint64_t buf;		/* record data */
+	uint32_t nr;		/* in: descs room, out: records received */
+	uint32_t buf_len;
+};
+
+#define DUMMY_SET_RX_FRAMED _IOW(DUMMY_IOC_MAGIC, 0x09, uint32_t)
+#define DUMMY_RECV_FRAMES _IOWR(DUMMY_IOC_MAGIC, 0x0a, struct dummy_recv_frames)
+
+/*RX ring size in bytes, rounded up to power of two. Only allowed while
+ * the caller is the only one who has the device open and nothing is
+ * mapped; data in the ring is dropped.
+ * */
+#define DUMMY_RX_RING_MIN	(4 * 1024)
+#define DUMMY_RX_RING_MAX	(64 * 1024 * 1024)
+#define DUMMY_SET_RX_RING_SIZE _IOW(DUMMY_IOC_MAGIC, 0x0b, uint32_t)
+
+/*What happens to a device frame which doesn't fit in the RX ring*/
+#define DUMMY_RX_BACKPRESSURE	0 /* device waits until readers drain it */
+#define DUMMY_RX_DROP_NEWEST	1 /* frame is dropped */
+#define DUMMY_RX_DROP_OLDEST	2 /* oldest data is overwritten; mmap()
+				   * readers have to check tail didn't move
+				   * past what they processed */
+
+struct dummy_rx_drops {
+	uint64_t overruns;	/* frames which found the ring full */
+	uint64_t dropped_bytes;	/* bytes dropped by the policy */
+};
+
+#define DUMMY_SET_RX_POLICY _IOW(DUMMY_IOC_MAGIC, 0x0c, uint32_t)
+#define DUMMY_GET_RX_DROPS _IOR(DUMMY_IOC_MAGIC, 0x0d, struct dummy_rx_drops)
+
+/*Device counters, also found in /sys/class/dummy/dummyN/stats/*/
+struct dummy_stats {
+	uint64_t rx_bytes;
+	uint64_t rx_frames;
+	uint64_t tx_bytes;
+	uint64_t tx_frames;
+	uint64_t poll_cycles;	/* passes over the device registers */
+	uint64_t empty_polls;	/* passes which found nothing to do */
+	uint64_t ring_hwm;	/* most bytes ever waiting in the RX ring */
+	uint64_t rx_overruns;	/* frames which found the RX ring full */
+	uint64_t rx_dropped;	/* bytes dropped by the RX policy */
+	uint64_t reader_sleeps;	/* readers which had to wait for data */
+	uint64_t writer_sleeps;	/* writers which had to wait for a slot */
+	uint64_t rd_contended;	/* readers which found the ring locked */
+	uint64_t wr_contended;	/* writers which found the queue locked */
+	uint64_t timer_overruns;/* hrtimer periods the poller missed */
+	uint64_t rx_xfer_cycles;/* time spent copying from the device */
+	uint64_t tx_xfer_cycles;/* time spent copying to the device */
+};
+
+#define DUMMY_GET_STATS _IOR(DUMMY_IOC_MAGIC, 0x0e, struct dummy_stats)
+
+/*Where the device poller runs. On the workqueue (the default) its CPU
+ * mask, nice level and NUMA placement are set through
+ * /sys/devices/virtual/workqueue/plat_dummyN/. A kthread of its own can
+ * be pinned to one CPU and run SCHED_FIFO; rt_prio and negative nice
+ * need CAP_SYS_NICE.
+ * */
+#define DUMMY_POLL_WQ		0
+#define DUMMY_POLL_KTHREAD	1
+
+struct dummy_poll_thread {
+	uint32_t mode;
+	int32_t cpu;		/* kthread: CPU to pin to, -1 for any */
+	uint32_t rt_prio;	/* kthread: SCHED_FIFO priority, 0 for normal */
+	int32_t nice;		/* kthread: nice level if rt_prio is 0 */
+};
+
+#define DUMMY_SET_POLL_THREAD _IOW(DUMMY_IOC_MAGIC, 0x0f, struct dummy_poll_thread)
+
+/*Broadcast mode: 1 gives the file a read cursor of its own, 0 drops it.
+ * Every subscribed file reads the whole stream, data is reclaimed once
+ * the slowest of them has read it. Plain read(), framed reads and
+ * DUMMY_RX_ADVANCE fail with EBUSY while there are subscribers; framed
+ * mode and broadcast mode don't mix on one file.
+ * */
+#define DUMMY_RX_SUBSCRIBE _IOW(DUMMY_IOC_MAGIC, 0x10, uint32_t)
+
+struct dummy_reader_lag {
+	uint32_t lag;		/* bytes the reader is behind now */
+	uint32_t lag_max;	/* most it ever was */
+	uint64_t dropped;	/* bytes lost to DUMMY_RX_DROP_OLDEST */
+	uint32_t evicted;	/* read() fails with EPIPE, subscribe again */
+	uint32_t reserved;
+};
+
+#define DUMMY_GET_READER_LAG _IOR(DUMMY_IOC_MAGIC, 0x11, struct dummy_reader_lag)
+
+/*When the ring is full, readers more than this many bytes behind are
+ * evicted instead of stalling the others. 0 (default) never evicts.
+ * */
+#define DUMMY_SET_RX_EVICT _IOW(DUMMY_IOC_MAGIC, 0x12, uint32_t)
+
+/*Receive timestamps: every record gets the time the poller saw
+ * DATA_READY for it and the time it was copied into the RX ring.
+ * The clock is per device, CLOCK_MONOTONIC by default.
+ * */
+#define DUMMY_TS_MONOTONIC	0
+#define DUMMY_TS_RAW		1 /* CLOCK_MONOTONIC_RAW, not NTP slewed */
+#define DUMMY_SET_TS_CLOCK _IOW(DUMMY_IOC_MAGIC, 0x13, uint32_t)
+
+struct dummy_frame_ts {
+	uint64_t seen_ns;	/* DATA_READY observed */
+	uint64_t stored_ns;	/* record copied out of the device */
+};
+
+/*DUMMY_RECV_FRAMES with a struct dummy_frame_ts [nr] per batch*/
+struct dummy_recv_frames_ts {
+	struct dummy_recv_frames frames;
+	uint64_t ts;		/* struct dummy_frame_ts [frames.nr] */
+};
+
+#define DUMMY_RECV_FRAMES_TS _IOWR(DUMMY_IOC_MAGIC, 0x14, struct dummy_recv_frames_ts)
+
+/*TX coalescing: writes are packed into one device transfer until it
+ * holds bytes, the next write doesn't fit in MEM_SIZE, delay_us passed
+ * since the first of them (0: no timeout) or the queue is flushed with
+ * DUMMY_TX_FLUSH or fsync(); fsync() also waits until the device took
+ * everything. bytes 0 (default) sends every write on its own.
+ * */
+#define DUMMY_TX_COALESCE_MAX_US 1000000
+
+struct dummy_tx_coalesce {
+	uint32_t bytes;
+	uint32_t delay_us;
+};
+
+#define DUMMY_SET_TX_COALESCE _IOW(DUMMY_IOC_MAGIC, 0x15, struct dummy_tx_coalesce)
+#define DUMMY_TX_FLUSH _IO(DUMMY_IOC_MAGIC, 0x16)
+
+/*Frames generated by the emulator (platform_test emulate=1) start with
+ * this header, ts_ns is CLOCK_MONOTONIC when the frame was posted.
+ * */
+#define DUMMY_EMU_MAGIC 0x554d4544 /* "DEMU" */
+struct dummy_emu_hdr {
+	uint32_t magic;
+	uint32_t seq;
+	uint64_t ts_ns;
+};
+
+/*RX ring can be mapped read-only with mmap():
+ * * page 0: struct dummy_ring_ctrl - producer/consumer counters;
+ * * page 1 and further: ring data, ctrl->size bytes (power of two).
+ * head and tail are free running byte counters, data offset of a counter
+ * is (counter & (size - 1)). head - tail bytes from tail are valid; load
+ * head with acquire semantics before reading them. Once processed they
+ * are released with DUMMY_RX_ADVANCE <number of bytes>. mmap() fails
+ * with EBUSY while a read() is in progress, retry it.
+ * */
+struct dummy_ring_ctrl {
+	uint32_t head;	/* bytes written by driver */
+	uint32_t tail;	/* bytes consumed by readers */
+	uint32_t size;	/* size of data area */
+};
+
+/*TX queue can be mapped read-write and shared at DUMMY_TX_MMAP_OFFSET:
+ * * page 0: struct dummy_tx_ctrl;
+ * * page 1 and further: ctrl->slots frames of ctrl->slot_size bytes.
+ * head and tail are free running frame counters. The producer fills slot
+ * (head & (slots - 1)) and its len[] entry, then stores head + 1 with
+ * release semantics. The driver picks committed frames up on its next
+ * poll pass; DUMMY_TX_DOORBELL starts one right away. tail counts frames
+ * the device took, slots from tail to head must not be touched. While
+ * the queue is mapped write() fails with EBUSY. Frames committed before
+ * the last munmap() are still sent, ahead of the next write().
+ * */
+#define DUMMY_TX_MMAP_OFFSET	0x10000000
+
+struct dummy_tx_ctrl {
+	uint32_t head;		/* frames committed by user */
+	uint32_t tail;		/* frames sent to device */
+	uint32_t slots;		/* power of two */
+	uint32_t slot_size;
+	uint32_t len[];		/* [slots], frame lengths */
+};
+
+#define DUMMY_TX_DOORBELL _IO(DUMMY_IOC_MAGIC, 0x17)
 
 #endif
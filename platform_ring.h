@@ -0,0 +1,308 @@
+#ifndef _PLATFORM_RING_H_
+#define _PLATFORM_RING_H_
+
+/*
+ * RX ring, TX queue and window protocol state, without the register and
+ * window accesses themselves. Only touches those fields of struct
+ * plat_dummy_device, so ring_test.c can build it in userspace against a
+ * mock device; it brings its own struct and barriers then.
+ */
+#ifdef __KERNEL__
+#include <linux/kernel.h>
+#include <asm/barrier.h>
+#include "platform_test.h"
+#include "platform_cdev.h"
+#endif
+
+#define MEM_SIZE			(0x1000)
+#define PLAT_IO_DATA_READY		(1) /*IO data ready flag */
+#define PLAT_WRITE_READY		(1 << 1)
+#define PLAT_TX_DONE			(1 << 2) /*Device took the host frame */
+#define PLAT_RX_FRAMES			(256) /*Frame boundaries kept for framed readers */
+
+/*One device transfer in the RX ring*/
+struct plat_dummy_frame {
+	u32 seq;		/* frame number */
+	u32 start;		/* ring head before the frame */
+	u32 len;
+	u64 seen_ns;		/* DATA_READY observed, ts_clock */
+	u64 stored_ns;		/* copied into the ring */
+};
+
+/*
+ * RX ring is single producer (poll work) / single consumer (readers,
+ * serialized by rd_mutex) with free running head/tail kept in the
+ * ctrl page. Each side only writes its own index, so neither needs the
+ * other's lock: acquire on the other side's index, release on our own.
+ */
+static inline u32 plat_dummy_rx_used(struct plat_dummy_device *my_dev)
+{
+	return smp_load_acquire(&my_dev->ring_ctrl->head) -
+	       READ_ONCE(my_dev->ring_ctrl->tail);
+}
+
+/* How much space is free? */
+static inline u32 plat_dummy_rx_free(struct plat_dummy_device *my_dev)
+{
+	return my_dev->buffersize -
+	       (my_dev->ring_ctrl->head -
+		smp_load_acquire(&my_dev->ring_ctrl->tail));
+}
+
+/*
+ * Ring position of counter pos and how many of len bytes fit before the
+ * ring end; the rest wraps to the start. All ring copies split here.
+ */
+static inline u32 plat_dummy_ring_split(struct plat_dummy_device *my_dev,
+					u32 pos, u32 len, u32 *off)
+{
+	*off = pos & (my_dev->buffersize - 1);
+	return min(len, my_dev->buffersize - *off);
+}
+
+/*
+ * Frame boundaries are kept in frames[], PLAT_RX_FRAMES entries indexed
+ * by frame number. They don't limit the ring: the producer reuses the
+ * oldest entry whether it was consumed or not, framed readers see the
+ * frames whose entries are gone as a gap in seq.
+ */
+
+/*
+ * Producer side: size bytes were copied to the ring at head, record the
+ * frame and publish both. Poll work only.
+ */
+static inline void plat_dummy_ring_commit(struct plat_dummy_device *my_dev,
+					  u32 head, u32 size, u64 seen_ns,
+					  u64 stored_ns)
+{
+	struct plat_dummy_frame *frame;
+
+	/* the entry may be in use, readers check frame_head after copying it */
+	smp_wmb();
+	frame = &my_dev->frames[my_dev->frame_head & (PLAT_RX_FRAMES - 1)];
+	frame->seq = my_dev->frame_head;
+	frame->start = head;
+	frame->len = size;
+	frame->seen_ns = seen_ns;
+	frame->stored_ns = stored_ns;
+
+	/* ring data has to be visible before the new head */
+	smp_store_release(&my_dev->ring_ctrl->head, head + size);
+	smp_store_release(&my_dev->frame_head, my_dev->frame_head + 1);
+}
+
+/*
+ * Copy of the first frame which was not consumed yet, false if there is
+ * none. Byte stream readers don't look at frames, so entries they
+ * consumed are skipped here and a frame they read partly is dropped;
+ * data of frames without an entry is dropped too. rd_mutex held.
+ */
+static inline bool plat_dummy_next_frame(struct plat_dummy_device *my_dev,
+					 struct plat_dummy_frame *frame)
+{
+	u32 head, tail = my_dev->ring_ctrl->tail;
+
+	for (;; my_dev->frame_tail++) {
+		head = smp_load_acquire(&my_dev->frame_head);
+		/* the entry at head - PLAT_RX_FRAMES may be rewritten now */
+		if (head - my_dev->frame_tail >= PLAT_RX_FRAMES)
+			my_dev->frame_tail = head - PLAT_RX_FRAMES + 1;
+		if (my_dev->frame_tail == head)
+			return false;
+
+		*frame = my_dev->frames[my_dev->frame_tail &
+					(PLAT_RX_FRAMES - 1)];
+		/* pairs with the smp_wmb() in plat_dummy_ring_commit() */
+		smp_rmb();
+		if (READ_ONCE(my_dev->frame_head) - my_dev->frame_tail >=
+		    PLAT_RX_FRAMES)
+			continue;	/* reused under us, count it lost */
+
+		if ((s32)(frame->start - tail) > 0) {
+			/* frames before this one lost their entries */
+			smp_store_release(&my_dev->ring_ctrl->tail, frame->start);
+			return true;
+		}
+		if (frame->start == tail)
+			return true;
+		if ((s32)(frame->start + frame->len - tail) > 0) {
+			/* byte reader took the beginning, drop the rest */
+			smp_store_release(&my_dev->ring_ctrl->tail,
+					  frame->start + frame->len);
+			tail = frame->start + frame->len;
+		}
+	}
+}
+
+/*Frame from plat_dummy_next_frame() was copied out. rd_mutex held*/
+static inline void plat_dummy_frame_consume(struct plat_dummy_device *my_dev,
+					    const struct plat_dummy_frame *frame)
+{
+	my_dev->frame_tail++;
+	/* data is copied out, producer may reuse the space */
+	smp_store_release(&my_dev->ring_ctrl->tail, frame->start + frame->len);
+}
+
+/*
+ * TX queue: tx_slots frames of up to MEM_SIZE bytes. Writers (serialized
+ * by wr_mutex) fill the slot at tx_head, poll work flushes the one at
+ * tx_tail; same acquire/release handover as the RX ring.
+ */
+static inline void *plat_dummy_tx_slot(struct plat_dummy_device *my_dev,
+				       u32 idx)
+{
+	return my_dev->tx_buf + (idx & (my_dev->tx_slots - 1)) * MEM_SIZE;
+}
+
+static inline u32 plat_dummy_tx_depth(struct plat_dummy_device *my_dev)
+{
+	return READ_ONCE(my_dev->tx_head) - READ_ONCE(my_dev->tx_tail);
+}
+
+static inline bool plat_dummy_tx_full(struct plat_dummy_device *my_dev)
+{
+	return my_dev->tx_head - smp_load_acquire(&my_dev->tx_tail) >=
+	       my_dev->tx_slots;
+}
+
+/*Hand the slot at tx_head over to the poll work. wr_mutex held*/
+static inline void plat_dummy_tx_publish(struct plat_dummy_device *my_device)
+{
+	u32 head = my_device->tx_head, depth;
+
+	my_device->tx_len[head & (my_device->tx_slots - 1)] = my_device->tx_fill;
+	my_device->tx_fill = 0;
+	smp_store_release(&my_device->tx_head, head + 1);
+	/* unmapped queue: the mmap() head follows ours */
+	WRITE_ONCE(my_device->tx_ctrl->head, head + 1);
+	depth = plat_dummy_tx_depth(my_device);
+	if (depth > my_device->tx_depth_max)
+		my_device->tx_depth_max = depth;
+}
+
+/*Slot at tx_tail went to the device, it is free for the next writer*/
+static inline void plat_dummy_tx_consume(struct plat_dummy_device *my_dev)
+{
+	u32 tail = my_dev->tx_tail + 1;
+
+	smp_store_release(&my_dev->tx_tail, tail);
+	smp_store_release(&my_dev->tx_ctrl->tail, tail);
+}
+
+/*Do seg more bytes fit in the open slot? If not it goes out first*/
+static inline bool plat_dummy_tx_fits(struct plat_dummy_device *my_dev,
+				      u32 seg)
+{
+	return !my_dev->tx_fill || my_dev->tx_fill + seg <= MEM_SIZE;
+}
+
+/*Account bytes copied to the open slot, true when it is to be published*/
+static inline bool plat_dummy_tx_filled(struct plat_dummy_device *my_dev,
+					u32 copied, u32 coalesce)
+{
+	my_dev->tx_fill += copied;
+	return !coalesce || my_dev->tx_fill >= coalesce;
+}
+
+/*
+ * Take over the frames the mmap() producer committed, also those of a
+ * mapping which is gone by now. Lengths are copied out of the shared
+ * page and clamped, a head which makes no sense is ignored until the
+ * producer fixes it. wr_mutex held, so write() never races it.
+ */
+static inline void plat_dummy_tx_sync(struct plat_dummy_device *my_device)
+{
+	struct dummy_tx_ctrl *ctrl = my_device->tx_ctrl;
+	u32 head, tail, i, mask = my_device->tx_slots - 1;
+
+	/* pairs with the producer's release of head */
+	head = smp_load_acquire(&ctrl->head);
+	if (head == my_device->tx_head)
+		return;
+
+	tail = smp_load_acquire(&my_device->tx_tail);
+	if (head - tail > my_device->tx_slots ||
+	    head - my_device->tx_head > head - tail)
+		return;
+
+	for (i = my_device->tx_head; i != head; i++)
+		my_device->tx_len[i & mask] = min_t(u32,
+						    READ_ONCE(ctrl->len[i & mask]),
+						    MEM_SIZE);
+	smp_store_release(&my_device->tx_head, head);
+}
+
+/*
+ * Register protocol, one window for both directions:
+ * * DATA_READY from the device: an RX frame of SIZE bytes is in the
+ *   window. The host copies it out, clears DATA_READY and sets
+ *   WRITE_READY, which hands the window back for TX.
+ * * WRITE_READY without DATA_READY: the window is free for TX. The host
+ *   fills it, writes SIZE, sets DATA_READY and clears WRITE_READY. The
+ *   frame is ours (tx_busy) until the device takes it: devices with
+ *   TX_DONE set it and may post RX right after, the host clears it;
+ *   others clear DATA_READY and must not post RX before the host saw it.
+ * The helpers below take the flag register value and return the one to
+ * write back; win_mutex held for all but the lockless checks.
+ */
+
+/*Has the device taken our frame? Returns status with TX_DONE acked*/
+static inline u32 plat_dummy_tx_complete(struct plat_dummy_device *my_device,
+					 u32 status)
+{
+	if (!my_device->has_tx_done) {
+		if (my_device->tx_busy && !(status & PLAT_IO_DATA_READY))
+			WRITE_ONCE(my_device->tx_busy, false);	/* device took it */
+	} else if (status & PLAT_TX_DONE) {
+		/* our frame is gone, DATA_READY from here on is RX */
+		WRITE_ONCE(my_device->tx_busy, false);
+		status &= ~PLAT_TX_DONE;
+	}
+	return status;
+}
+
+/*An RX frame from the device, not our own TX frame, is in the window*/
+static inline bool plat_dummy_rx_pending(struct plat_dummy_device *my_device,
+					 u32 status)
+{
+	return (status & PLAT_IO_DATA_READY) && !READ_ONCE(my_device->tx_busy);
+}
+
+/*RX frame was copied out: the window goes back to the host for TX*/
+static inline u32 plat_dummy_rx_release(u32 status)
+{
+	return (status & ~PLAT_IO_DATA_READY) | PLAT_WRITE_READY;
+}
+
+static inline bool plat_dummy_win_free(u32 status)
+{
+	return (status & PLAT_WRITE_READY) && !(status & PLAT_IO_DATA_READY);
+}
+
+/*Our frame was written to a free window: hand it to the device*/
+static inline u32 plat_dummy_tx_post(struct plat_dummy_device *my_device,
+				     u32 status)
+{
+	WRITE_ONCE(my_device->tx_busy, true);
+	return (status | PLAT_IO_DATA_READY) & ~PLAT_WRITE_READY;
+}
+
+/*Window is free and there may be something to send*/
+static inline bool plat_dummy_tx_ready(struct plat_dummy_device *my_device,
+				       u32 status)
+{
+	return plat_dummy_win_free(status) &&
+	       (plat_dummy_tx_depth(my_device) ||
+		READ_ONCE(my_device->tx_ctrl->head) !=
+		READ_ONCE(my_device->tx_head));
+}
+
+/*Is the device asserting its line for this status?*/
+static inline bool plat_dummy_irq_pending(struct plat_dummy_device *my_device,
+					  u32 status)
+{
+	return plat_dummy_rx_pending(my_device, status) ||
+	       (my_device->has_tx_done && (status & PLAT_TX_DONE));
+}
+
+#endif /* _PLATFORM_RING_H_ */
@@ -4,356 +4,2285 @@
 #include <linux/hrtimer.h>
 #include <linux/ktime.h>
 #include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/poll.h>
+#include <linux/timex.h>
+#include <linux/interrupt.h>
+#include <linux/log2.h>
+#include <linux/idr.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <uapi/linux/sched/types.h>
+#include <linux/uio.h>
 #include <asm/uaccess.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <asm/io.h>
 #include <linux/uaccess.h>
 #include "platform_test.h"
+#include "platform_cdev.h"
+#include "platform_ring.h"
+
+#define CREATE_TRACE_POINTS
+#include "platform_test_trace.h"
 
 
 #define DRV_NAME  "plat_dummy"
 
-#define MEM_SIZE			(0x1000)
-#define REG_SIZE			(8)
-#define DEVICE_POOLING_TIME_MS		(5) /*500 ms*/
+#define REG_SIZE			(8)
+#define DEVICE_POOLING_TIME_MS		(5) /*500 ms*/
+
+#define PLAT_IO_FLAG_REG		(0) /*Offset of flag register*/
+#define PLAT_IO_SIZE_REG		(4) /*Offset of flag register*/
+#define MAX_DUMMY_PLAT_THREADS		(2) /*RX and TX engines run side by side */
+#define PLAT_NAPI_BUDGET		(16) /*Poll passes before yielding */
+#define PLAT_NAPI_SCHED			(0) /*napi_state: poller owns device */
+
+
+/*Device has 2 resources:
+ * * 1) 4K of memory at address defined by dts - used for data transfer;
+ * * 2) Two 32-bit registers at address (defined by dts)
+ * *  2.1. Flag Register: @offset 0
+ * *	bit 0: PLAT_IO_DATA_READY - set to 1 if data from device ready
+ * *	bit 1: PLAT_WRITE_READY - window is free for host TX
+ * *	bit 2: PLAT_TX_DONE - device consumed the host frame, host clears it
+ * *	       (only devices with "ti,tx-done" and the emulator, reserved
+ * *	       otherwise: those clear DATA_READY when they took the frame)
+ * *	other bits: reserved;
+ * * 2.2. Data size Register @offset 4: - Contain data size from device
+ * (0..4095);
+ * * 3) Optional interrupt line, level high while the device has an RX
+ * frame posted (DATA_READY) or TX_DONE is set; both are cleared by the
+ * host. Devices without TX_DONE don't raise it for TX at all.
+ * WRITE_READY is the idle state and doesn't raise it. Without the line
+ * the device is polled every js_pool_time.
+ * */
+
+/*Following has to be added to dts file to support it, the alias
+ * number is the device index (/dev/dummy/dummyN), devices without one
+ * get the first free index. Load with num_devices=0 on such boards.
+ * *aliases {
+ * *		dummy0 = &my_dummy1;
+ * *		dummy1 = &my_dummy2;
+ * *};
+ * *
+ * *my_dummy1: dummy@9f200000 {
+ * *		compatible = "ti,plat_dummy";
+ * *		reg = <0x9f200000 0x1000>,
+ * *				<0x9f201000 0x8>;
+ * *		interrupts = <GIC_SPI 100 IRQ_TYPE_LEVEL_HIGH>; (optional)
+ * *		ti,tx-done; (optional, device sets PLAT_TX_DONE)
+ * *};
+ * *
+ * *my_dummy2: dummy@9f210000 {
+ * *		compatible = "ti,plat_dummy";
+ * *		reg = <0x9f210000 0x1000>,
+ * *				<0x9f211000 0x8>;
+ * *};
+ * *
+ * */
+/*Without DT the devices are created by the module, one every DEV_STRIDE*/
+#define MEM_BASE_1	(0x88000000)
+#define REG_BASE_1	(0x88001000)
+#define DEV_STRIDE	(0x10000)
+
+static unsigned int num_devices = 2;
+module_param(num_devices, uint, 0444);
+MODULE_PARM_DESC(num_devices, "Devices to create without DT (0.." __stringify(DUMMY_MAX_DEVICES) ")");
+
+static struct platform_device **dummy_pdevs;	/* created by the module */
+
+/*Device index -> device, an index is reserved with NULL until probe is done*/
+static DEFINE_IDR(plat_dummy_idr);
+static DEFINE_MUTEX(plat_dummy_idr_lock);
+static int plat_dummy_nr_ids;	/* highest index in use + 1 */
+
+/*Devices without IRQ line which get interrupts from DUMMY_INJECT_IRQ*/
+static unsigned int soft_irq_mask;
+module_param(soft_irq_mask, uint, 0444);
+MODULE_PARM_DESC(soft_irq_mask, "Bitmask of devices driven by software injected interrupts");
+
+/*Result of one pass over the device registers*/
+enum plat_poll_result {
+	PLAT_POLL_IDLE,		/* nothing to do */
+	PLAT_POLL_BUSY,		/* data moved in either direction */
+	PLAT_POLL_STALLED,	/* data pending, but no room in the ring */
+};
+
+static bool poll_highpri;
+module_param(poll_highpri, bool, 0444);
+MODULE_PARM_DESC(poll_highpri, "Run the poll workqueues at WQ_HIGHPRI");
+
+/*Frames writers may queue before they block*/
+#define MAX_TX_SLOTS 256
+static unsigned int tx_slots = 8;
+module_param(tx_slots, uint, 0444);
+MODULE_PARM_DESC(tx_slots, "TX queue length in frames of up to 4K, rounded up to power of two");
+
+/*RX ring size in bytes, rounded up to power of two*/
+static unsigned int rx_ring_size = DUMMY_IO_BUFF_SIZE;
+module_param(rx_ring_size, uint, 0444);
+MODULE_PARM_DESC(rx_ring_size, "RX ring size in bytes (4K ~ 64M)");
+
+static void plat_dummy_kick(struct plat_dummy_device *my_device);
+static void plat_dummy_tx_kick(struct plat_dummy_device *my_device);
+static void plat_dummy_napi_schedule(struct plat_dummy_device *my_device);
+
+static bool plat_dummy_irq_mode(struct plat_dummy_device *my_device)
+{
+	return my_device->irq > 0 || my_device->soft_irq;
+}
+
+/*
+ * Poll work runs on the device workqueue or, once DUMMY_SET_POLL_THREAD
+ * asked for it, on a dedicated kthread. kworker only changes while
+ * polling is stopped.
+ */
+static bool plat_dummy_queue_work(struct plat_dummy_device *my_device,
+				  unsigned long delay)
+{
+	if (my_device->kworker)
+		return kthread_queue_delayed_work(my_device->kworker,
+						  &my_device->kdwork, delay);
+	return queue_delayed_work(my_device->data_read_wq, &my_device->dwork,
+				  delay);
+}
+
+static bool plat_dummy_mod_work(struct plat_dummy_device *my_device,
+				unsigned long delay)
+{
+	if (my_device->kworker)
+		return kthread_mod_delayed_work(my_device->kworker,
+						&my_device->kdwork, delay);
+	return mod_delayed_work(my_device->data_read_wq, &my_device->dwork,
+				delay);
+}
+
+static void plat_dummy_cancel_work(struct plat_dummy_device *my_device)
+{
+	if (my_device->kworker)
+		kthread_cancel_delayed_work_sync(&my_device->kdwork);
+	else
+		cancel_delayed_work_sync(&my_device->dwork);
+}
+
+/*Bulk copies let the arch use word sized accesses instead of ioread8()*/
+static void plat_dummy_mem_read(struct plat_dummy_device *my_dev, void *dst,
+				u32 offset, u32 len)
+{
+	memcpy_fromio(dst, my_dev->mem + offset, len);
+}
+
+static void plat_dummy_mem_write(struct plat_dummy_device *my_dev, u32 offset,
+				 const void *src, u32 len)
+{
+	memcpy_toio(my_dev->mem + offset, src, len);
+}
+
+static u32 plat_dummy_reg_read32(struct plat_dummy_device *my_dev, u32 offset)
+{
+	return ioread32(my_dev->regs + offset);
+}
+static void plat_dummy_reg_write32(struct plat_dummy_device *my_dev, u32 offset
+				   , u32 val)
+{
+	iowrite32(val, my_dev->regs + offset);
+}
+
+/*Lock which counts how often it was found taken*/
+static int plat_dummy_lock(struct mutex *lock, u64 *contended)
+{
+	if (mutex_trylock(lock))
+		return 0;
+
+	if (mutex_lock_interruptible(lock))
+		return -ERESTARTSYS;
+	(*contended)++;		/* protected by the lock now */
+	return 0;
+}
+
+/*Frame timestamps, in the clock DUMMY_SET_TS_CLOCK picked*/
+static u64 plat_dummy_ts(struct plat_dummy_device *my_dev)
+{
+	if (READ_ONCE(my_dev->ts_clock) == DUMMY_TS_RAW)
+		return ktime_get_raw_ns();
+	return ktime_get_ns();
+}
+
+static int set_ts_clock(struct plat_dummy_device *my_device, u32 clock)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	if (clock > DUMMY_TS_RAW) {
+		pr_err("%s: Value out of range %u\n", __func__, clock);
+		return -EINVAL;
+	}
+
+	WRITE_ONCE(my_device->ts_clock, clock);
+	return 0;
+}
+
+static void plat_dummy_frame_done(struct plat_dummy_device *my_dev,
+				  const struct plat_dummy_frame *frame)
+{
+	trace_plat_dummy_rx_pop(my_dev->id, frame->start, frame->len);
+	plat_dummy_frame_consume(my_dev, frame);
+}
+
+static bool plat_dummy_frames_pending(struct plat_dummy_device *my_dev)
+{
+	return smp_load_acquire(&my_dev->frame_head) !=
+	       READ_ONCE(my_dev->frame_tail);
+}
+
+/*Takes rd_mutex and waits for a complete frame, returned in frame*/
+static int plat_dummy_wait_frame(struct plat_dummy_device *my_device,
+				 bool nonblock, struct plat_dummy_frame *frame)
+{
+	if (plat_dummy_lock(&my_device->rd_mutex, &my_device->rd_contended))
+		return -ERESTARTSYS;
+
+	/* frames are skipped by moving the tail, broadcast readers own it */
+	while (!my_device->nr_readers &&
+	       !plat_dummy_next_frame(my_device, frame)) {
+		if (!nonblock)
+			my_device->rd_sleeps++;
+		mutex_unlock(&my_device->rd_mutex);
+		if (nonblock)
+			return -EAGAIN;
+		trace_plat_dummy_reader_wait(my_device->id, 0);
+		if (wait_event_interruptible(my_device->rwq,
+					     plat_dummy_frames_pending(my_device)))
+			return -ERESTARTSYS;
+		trace_plat_dummy_reader_wake(my_device->id,
+					     plat_dummy_rx_used(my_device));
+		if (plat_dummy_lock(&my_device->rd_mutex, &my_device->rd_contended))
+			return -ERESTARTSYS;
+	}
+
+	if (my_device->nr_readers) {
+		mutex_unlock(&my_device->rd_mutex);
+		return -EBUSY;
+	}
+	return 0;
+}
+
+/*Copy len bytes of ring data at counter pos to user, handles the wrap*/
+static int plat_dummy_copy_out(struct plat_dummy_device *my_dev,
+			       char __user *buf, u32 pos, u32 len)
+{
+	u32 off, first = plat_dummy_ring_split(my_dev, pos, len, &off);
+
+	if (copy_to_user(buf, my_dev->buffer + off, first) ||
+	    copy_to_user(buf + first, my_dev->buffer, len - first))
+		return -EFAULT;
+	return 0;
+}
+
+/*Copy count bytes of ring data at counter pos to the iter, handles the wrap*/
+static size_t plat_dummy_ring_to_iter(struct plat_dummy_device *my_dev,
+				      u32 pos, size_t count,
+				      struct iov_iter *to)
+{
+	u32 off, first = plat_dummy_ring_split(my_dev, pos, count, &off);
+	size_t copied;
+
+	copied = copy_to_iter(my_dev->buffer + off, first, to);
+	if (copied == first && count > first)
+		copied += copy_to_iter(my_dev->buffer, count - first, to);
+	return copied;
+}
+
+/*Framed read(): one frame per call, the part which doesn't fit is lost*/
+static ssize_t plat_dummy_read_frame(struct plat_dummy_device *my_device,
+				     struct iov_iter *to, bool nonblock)
+{
+	struct plat_dummy_frame frame;
+	size_t copied, count;
+	int err;
+
+	if (!my_device)
+		return -EFAULT;
+
+	err = plat_dummy_wait_frame(my_device, nonblock, &frame);
+	if (err)
+		return err;
+
+	count = min_t(size_t, iov_iter_count(to), frame.len);
+	copied = plat_dummy_ring_to_iter(my_device, frame.start, count, to);
+	if (copied != count) {
+		mutex_unlock(&my_device->rd_mutex);
+		return -EFAULT;
+	}
+
+	plat_dummy_frame_done(my_device, &frame);
+	mutex_unlock(&my_device->rd_mutex);
+	return copied;
+}
+
+/*recvmmsg() like: up to req->nr whole frames packed into req->buf*/
+static int plat_dummy_recv_frames(struct plat_dummy_device *my_device,
+				  struct dummy_recv_frames *req, u64 ts,
+				  bool nonblock)
+{
+	struct dummy_frame_desc __user *udesc = u64_to_user_ptr(req->descs);
+	struct dummy_frame_ts __user *uts = u64_to_user_ptr(ts);
+	char __user *ubuf = u64_to_user_ptr(req->buf);
+	struct plat_dummy_frame frame;
+	struct dummy_frame_desc desc;
+	struct dummy_frame_ts fts;
+	u32 n = 0, used = 0;
+	int err;
+
+	if (!my_device)
+		return -EFAULT;
+
+	if (!req->nr || !req->buf_len)
+		return -EINVAL;
+
+	err = plat_dummy_wait_frame(my_device, nonblock, &frame);
+	if (err)
+		return err;
+
+	do {
+		desc.seq = frame.seq;
+		desc.len = frame.len;
+		desc.offset = used;
+		desc.flags = 0;
+		if (desc.len > req->buf_len - used) {
+			if (n)
+				break;	/* next call gets it whole */
+			desc.len = req->buf_len;
+			desc.flags |= DUMMY_FRAME_TRUNC;
+		}
+
+		if (plat_dummy_copy_out(my_device, ubuf + used, frame.start,
+					desc.len) ||
+		    copy_to_user(&udesc[n], &desc, sizeof(desc))) {
+			err = -EFAULT;
+			break;
+		}
+
+		if (uts) {
+			fts.seen_ns = frame.seen_ns;
+			fts.stored_ns = frame.stored_ns;
+			if (copy_to_user(&uts[n], &fts, sizeof(fts))) {
+				err = -EFAULT;
+				break;
+			}
+		}
+
+		plat_dummy_frame_done(my_device, &frame);
+		used += desc.len;
+		n++;
+	} while (n < req->nr && plat_dummy_next_frame(my_device, &frame));
+	mutex_unlock(&my_device->rd_mutex);
+
+	req->nr = n;
+	return n ? 0 : err;
+}
+
+static ssize_t plat_dummy_read(struct plat_dummy_device *my_device,
+			       struct iov_iter *to, bool nonblock)
+{
+	u32 used, tail;
+	size_t count, copied;
+
+	if (!my_device)
+		return -EFAULT;
+
+	if (plat_dummy_lock(&my_device->rd_mutex, &my_device->rd_contended))
+		return -ERESTARTSYS;
+
+	while (!(used = plat_dummy_rx_used(my_device))) { /* nothing to read */
+		if (!nonblock)
+			my_device->rd_sleeps++;
+		mutex_unlock(&my_device->rd_mutex); /* release the lock */
+		if (nonblock)
+			return -EAGAIN;
+		trace_plat_dummy_reader_wait(my_device->id, 0);
+		if (wait_event_interruptible(my_device->rwq,
+					     plat_dummy_rx_used(my_device)))
+			return -ERESTARTSYS;	/* signal: tell the fs layer to handle it */
+		trace_plat_dummy_reader_wake(my_device->id,
+					     plat_dummy_rx_used(my_device));
+		/* otherwise loop, but first reacquire the lock */
+		if (plat_dummy_lock(&my_device->rd_mutex, &my_device->rd_contended))
+			return -ERESTARTSYS;
+	}
+	/* ok, data is there, return something */
+	if (my_device->nr_readers) {
+		/* ring belongs to the broadcast readers */
+		mutex_unlock(&my_device->rd_mutex);
+		return -EBUSY;
+	}
+
+	/* wrapped data goes out in one call: up to the ring end, then the rest */
+	count = min(iov_iter_count(to), (size_t)used);
+	tail = my_device->ring_ctrl->tail;
+	copied = plat_dummy_ring_to_iter(my_device, tail, count, to);
+	if (!copied) {
+		mutex_unlock (&my_device->rd_mutex);
+		return -EFAULT;
+	}
+
+	/* data is copied out, producer may reuse the space */
+	trace_plat_dummy_rx_pop(my_device->id, tail, copied);
+	smp_store_release(&my_device->ring_ctrl->tail, tail + copied);
+	mutex_unlock (&my_device->rd_mutex);
+
+	dev_dbg(&my_device->pdev->dev, "\"%s\" did read %li bytes\n",
+		current->comm, (long)copied);
+	return copied;
+}
+
+/*
+ * Broadcast readers: every subscribed file reads the whole stream through
+ * a cursor of its own, straight from the shared ring. The ring tail
+ * follows the slowest reader which was not evicted. Readers, their
+ * cursors and the tail are protected by rd_mutex; plain readers get
+ * -EBUSY while there are subscribers.
+ */
+static void plat_dummy_readers_tail(struct plat_dummy_device *my_dev)
+{
+	struct plat_dummy_reader *reader;
+	u32 head = smp_load_acquire(&my_dev->ring_ctrl->head);
+	u32 lag = 0;
+	bool found = false;
+
+	list_for_each_entry(reader, &my_dev->readers, node) {
+		if (reader->evicted)
+			continue;
+		if (!found || head - reader->pos > lag)
+			lag = head - reader->pos;
+		found = true;
+	}
+
+	/* nobody is left to read it: keep the data for plain readers */
+	if (found)
+		smp_store_release(&my_dev->ring_ctrl->tail, head - lag);
+}
+
+static bool plat_dummy_reader_pending(struct plat_dummy_device *my_dev,
+				      struct plat_dummy_reader *reader)
+{
+	return READ_ONCE(reader->evicted) || list_empty_careful(&reader->node) ||
+	       smp_load_acquire(&my_dev->ring_ctrl->head) !=
+	       READ_ONCE(reader->pos);
+}
+
+/*Also brings an evicted reader back, at the slowest reader's position*/
+static int plat_dummy_rx_subscribe(struct plat_dummy_device *my_device,
+				   struct plat_dummy_reader *reader)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	mutex_lock(&my_device->rd_mutex);
+	if (list_empty(&reader->node)) {
+		list_add_tail(&reader->node, &my_device->readers);
+		my_device->nr_readers++;
+	}
+	/* starts with what the slowest reader hasn't read yet */
+	reader->pos = my_device->ring_ctrl->tail;
+	WRITE_ONCE(reader->evicted, false);
+	mutex_unlock(&my_device->rd_mutex);
+
+	return 0;
+}
+
+static void plat_dummy_rx_unsubscribe(struct plat_dummy_device *my_device,
+				      struct plat_dummy_reader *reader)
+{
+	if (!my_device)
+		return;
+
+	mutex_lock(&my_device->rd_mutex);
+	if (!list_empty(&reader->node)) {
+		list_del_init(&reader->node);
+		my_device->nr_readers--;
+		plat_dummy_readers_tail(my_device);
+	}
+	mutex_unlock(&my_device->rd_mutex);
+	wake_up_interruptible(&my_device->rwq);
+}
+
+static ssize_t plat_dummy_read_reader(struct plat_dummy_device *my_device,
+				      struct plat_dummy_reader *reader,
+				      struct iov_iter *to, bool nonblock)
+{
+	u32 used;
+	size_t copied;
+
+	if (!my_device)
+		return -EFAULT;
+
+	if (plat_dummy_lock(&my_device->rd_mutex, &my_device->rd_contended))
+		return -ERESTARTSYS;
+
+	while (!list_empty(&reader->node) && !reader->evicted &&
+	       !(used = smp_load_acquire(&my_device->ring_ctrl->head) -
+			reader->pos)) {
+		if (!nonblock)
+			my_device->rd_sleeps++;
+		mutex_unlock(&my_device->rd_mutex);
+		if (nonblock)
+			return -EAGAIN;
+		trace_plat_dummy_reader_wait(my_device->id, 0);
+		if (wait_event_interruptible(my_device->rwq,
+					     plat_dummy_reader_pending(my_device,
+								       reader)))
+			return -ERESTARTSYS;
+		trace_plat_dummy_reader_wake(my_device->id,
+					     plat_dummy_rx_used(my_device));
+		if (plat_dummy_lock(&my_device->rd_mutex, &my_device->rd_contended))
+			return -ERESTARTSYS;
+	}
+
+	if (list_empty(&reader->node)) {
+		mutex_unlock(&my_device->rd_mutex);
+		return -EINVAL;
+	}
+
+	if (reader->evicted) {
+		/* fell behind: subscribe again to get back in */
+		mutex_unlock(&my_device->rd_mutex);
+		return -EPIPE;
+	}
+
+	if (used > reader->lag_max)
+		reader->lag_max = used;
+
+	copied = plat_dummy_ring_to_iter(my_device, reader->pos,
+					 min(iov_iter_count(to), (size_t)used),
+					 to);
+	if (!copied) {
+		mutex_unlock(&my_device->rd_mutex);
+		return -EFAULT;
+	}
+
+	trace_plat_dummy_rx_pop(my_device->id, reader->pos, copied);
+	reader->pos += copied;
+	plat_dummy_readers_tail(my_device);
+	mutex_unlock(&my_device->rd_mutex);
+
+	return copied;
+}
+
+static unsigned int plat_dummy_poll_reader(struct plat_dummy_device *my_device,
+					   struct plat_dummy_reader *reader,
+					   struct file *filp, poll_table *wait)
+{
+	unsigned int mask;
+
+	if (!my_device)
+		return POLLERR;
+
+	mask = my_device->dummy_poll(my_device, filp, wait);
+	mask &= ~(POLLIN | POLLRDNORM);
+	if (READ_ONCE(reader->evicted))
+		mask |= POLLERR;
+	else if (plat_dummy_reader_pending(my_device, reader))
+		mask |= POLLIN | POLLRDNORM;
+	return mask;
+}
+
+static int plat_dummy_get_reader_lag(struct plat_dummy_device *my_device,
+				     struct plat_dummy_reader *reader,
+				     struct dummy_reader_lag *lag)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	mutex_lock(&my_device->rd_mutex);
+	lag->lag = smp_load_acquire(&my_device->ring_ctrl->head) - reader->pos;
+	lag->lag_max = max(reader->lag_max, lag->lag);
+	lag->dropped = reader->dropped;
+	lag->evicted = reader->evicted;
+	lag->reserved = 0;
+	mutex_unlock(&my_device->rd_mutex);
+	return 0;
+}
+
+static int set_rx_evict(struct plat_dummy_device *my_device, u32 lag)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	if (lag >= DUMMY_RX_RING_MAX) {
+		pr_err("%s: Value out of range %u\n", __func__, lag);
+		return -EINVAL;
+	}
+
+	WRITE_ONCE(my_device->rx_evict_lag, lag);
+	return 0;
+}
+
+/*
+ * Coalescing: small writes are packed into the slot at tx_head until it
+ * holds tx_coalesce bytes, the next write doesn't fit, tx_coalesce_ns
+ * passed since the first byte, or someone flushes.
+ */
+static void plat_dummy_tx_arm(struct plat_dummy_device *my_device)
+{
+	u64 delay = READ_ONCE(my_device->tx_coalesce_ns);
+
+	my_device->tx_open_ns = ktime_get_ns();
+	if (delay)
+		hrtimer_start(&my_device->tx_timer, ns_to_ktime(delay),
+			      HRTIMER_MODE_REL);
+}
+
+static enum hrtimer_restart plat_dummy_tx_timer(struct hrtimer *timer)
+{
+	struct plat_dummy_device *my_device;
+
+	my_device = container_of(timer, struct plat_dummy_device, tx_timer);
+	schedule_work(&my_device->tx_flush_work);	/* needs wr_mutex */
+	return HRTIMER_NORESTART;
+}
+
+static void plat_dummy_tx_flush_work(struct work_struct *work)
+{
+	struct plat_dummy_device *my_device;
+	u64 age, delay;
+	bool flushed = false;
+
+	my_device = container_of(work, struct plat_dummy_device, tx_flush_work);
+
+	mutex_lock(&my_device->wr_mutex);
+	if (my_device->tx_fill) {
+		age = ktime_get_ns() - my_device->tx_open_ns;
+		delay = READ_ONCE(my_device->tx_coalesce_ns);
+		if (age >= delay) {
+			plat_dummy_tx_publish(my_device);
+			flushed = true;
+		} else {
+			/* timer was for a slot which went out already */
+			hrtimer_start(&my_device->tx_timer,
+				      ns_to_ktime(delay - age),
+				      HRTIMER_MODE_REL);
+		}
+	}
+	mutex_unlock(&my_device->wr_mutex);
+	if (flushed)
+		plat_dummy_kick(my_device);
+}
+
+/*DUMMY_TX_FLUSH and fsync(): send a partly filled slot now*/
+static int plat_dummy_tx_flush(struct plat_dummy_device *my_device,
+			       bool wait)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	if (plat_dummy_lock(&my_device->wr_mutex, &my_device->wr_contended))
+		return -ERESTARTSYS;
+	if (my_device->tx_fill)
+		plat_dummy_tx_publish(my_device);
+	mutex_unlock(&my_device->wr_mutex);
+	plat_dummy_kick(my_device);
+
+	/* fsync(): until the device took everything */
+	if (wait && wait_event_interruptible(my_device->wwq,
+					     !plat_dummy_tx_depth(my_device)))
+		return -ERESTARTSYS;
+	return 0;
+}
+
+static int set_tx_coalesce(struct plat_dummy_device *my_device,
+			   struct dummy_tx_coalesce *coalesce)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	if (coalesce->bytes > MEM_SIZE ||
+	    coalesce->delay_us > DUMMY_TX_COALESCE_MAX_US) {
+		pr_err("%s: Value out of range\n", __func__);
+		return -EINVAL;
+	}
+
+	mutex_lock(&my_device->wr_mutex);
+	WRITE_ONCE(my_device->tx_coalesce, coalesce->bytes);
+	WRITE_ONCE(my_device->tx_coalesce_ns,
+		   (u64)coalesce->delay_us * NSEC_PER_USEC);
+	if (!coalesce->bytes && my_device->tx_fill)
+		plat_dummy_tx_publish(my_device);
+	mutex_unlock(&my_device->wr_mutex);
+	plat_dummy_kick(my_device);
+	return 0;
+}
+
+/*
+ * Every iovec segment is queued as a frame of its own, segments longer
+ * than MEM_SIZE are split; with tx_coalesce they are packed together
+ * instead. Blocking writers wait for free slots until everything is
+ * queued, the others stop at the first full queue.
+ */
+static ssize_t plat_dummy_write(struct plat_dummy_device *my_device,
+				struct iov_iter *from, bool nonblock)
+{
+	ssize_t written = 0, err = 0;
+	size_t seg, copied;
+	u32 head, fill, coalesce;
+	ktime_t stall;
+
+	if (!my_device)
+		return -EFAULT;
+
+	if (plat_dummy_lock(&my_device->wr_mutex, &my_device->wr_contended))
+		return -ERESTARTSYS;
+
+	while (iov_iter_count(from)) {
+		/* frames left by an mmap() producer go first */
+		plat_dummy_tx_sync(my_device);
+		while (plat_dummy_tx_full(my_device)) { /* all slots wait for device */
+			mutex_unlock(&my_device->wr_mutex);
+			if (written)
+				plat_dummy_kick(my_device);
+			if (nonblock)
+				return written ? written : -EAGAIN;
+			stall = ktime_get();
+			trace_plat_dummy_writer_wait(my_device->id, 0);
+			if (wait_event_interruptible(my_device->wwq,
+						     !plat_dummy_tx_full(my_device)))
+				return written ? written : -ERESTARTSYS;
+			trace_plat_dummy_writer_wake(my_device->id,
+						     my_device->tx_slots -
+						     plat_dummy_tx_depth(my_device));
+			if(plat_dummy_lock(&my_device->wr_mutex, &my_device->wr_contended))
+				return written ? written : -ERESTARTSYS;
+			my_device->tx_stalls++;
+			my_device->tx_stall_ns += ktime_to_ns(ktime_sub(ktime_get(),
+									stall));
+		}
+
+		/* queue belongs to the mmap() producer, also after a wait */
+		if (atomic_read(&my_device->tx_maps)) {
+			err = -EBUSY;
+			break;
+		}
+
+		seg = iov_iter_single_seg_count(from);
+		if (!seg || seg > MEM_SIZE)
+			seg = min_t(size_t, iov_iter_count(from), MEM_SIZE);
+
+		head = my_device->tx_head;
+		fill = my_device->tx_fill;	/* 0 unless coalescing */
+		if (!plat_dummy_tx_fits(my_device, seg)) {
+			/* doesn't fit: send what is there, go for the next slot */
+			plat_dummy_tx_publish(my_device);
+			continue;
+		}
+
+		copied = copy_from_iter(plat_dummy_tx_slot(my_device, head) + fill,
+					seg, from);
+		if (!copied) {
+			err = -EFAULT;
+			break;
+		}
+		trace_plat_dummy_tx_fill(my_device->id, head, copied);
+
+		coalesce = READ_ONCE(my_device->tx_coalesce);
+		if (plat_dummy_tx_filled(my_device, copied, coalesce))
+			plat_dummy_tx_publish(my_device);
+		else if (!fill)
+			plat_dummy_tx_arm(my_device);
+		written += copied;
+		if (copied < seg) /* fault in the middle of the buffer */
+			break;
+	}
+	mutex_unlock(&my_device->wr_mutex);
+	if (written)
+		plat_dummy_kick(my_device);
+
+	return written ? written : err;
+}
+
+static int plat_dummy_get_tx_stats(struct plat_dummy_device *my_device,
+				   struct dummy_tx_stats *stats)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	mutex_lock(&my_device->wr_mutex);
+	stats->slots = my_device->tx_slots;
+	stats->depth = plat_dummy_tx_depth(my_device);
+	stats->depth_max = my_device->tx_depth_max;
+	stats->frames = READ_ONCE(my_device->tx_xfers);
+	stats->stalls = my_device->tx_stalls;
+	stats->stall_ns = my_device->tx_stall_ns;
+	mutex_unlock(&my_device->wr_mutex);
+	return 0;
+}
+
+static unsigned int plat_dummy_poll(struct plat_dummy_device *my_device,
+				    struct file *filp, poll_table *wait)
+{
+	unsigned int mask = 0;
+	u32 head;
+
+	if (!my_device)
+		return POLLERR;
+
+	poll_wait(filp, &my_device->rwq, wait);
+	poll_wait(filp, &my_device->wwq, wait);
+	if (plat_dummy_rx_used(my_device))
+		mask |= POLLIN | POLLRDNORM;	/* readable */
+	/* mmap() producer: room in its ring, poller may not have seen head yet */
+	head = atomic_read(&my_device->tx_maps) ?
+	       READ_ONCE(my_device->tx_ctrl->head) : READ_ONCE(my_device->tx_head);
+	if (head - READ_ONCE(my_device->tx_tail) < my_device->tx_slots)
+		mask |= POLLOUT | POLLWRNORM;	/* writable */
+	return mask;
+}
+
+/*Release count bytes consumed in place through the mmap()ed ring*/
+static int plat_dummy_rx_advance(struct plat_dummy_device *my_device,
+				 u32 count)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	if (plat_dummy_lock(&my_device->rd_mutex, &my_device->rd_contended))
+		return -ERESTARTSYS;
+
+	if (my_device->nr_readers) {
+		mutex_unlock(&my_device->rd_mutex);
+		return -EBUSY;
+	}
+
+	if (count > plat_dummy_rx_used(my_device)) {
+		mutex_unlock(&my_device->rd_mutex);
+		return -EINVAL;
+	}
+
+	trace_plat_dummy_rx_pop(my_device->id, my_device->ring_ctrl->tail, count);
+	smp_store_release(&my_device->ring_ctrl->tail,
+			  my_device->ring_ctrl->tail + count);
+	mutex_unlock(&my_device->rd_mutex);
+
+	return 0;
+}
+
+/*Mappings are counted, the ring can't be resized under them*/
+static void plat_dummy_vm_open(struct vm_area_struct *vma)
+{
+	struct plat_dummy_device *my_device = vma->vm_private_data;
+
+	atomic_inc(&my_device->rx_maps);
+}
+
+static void plat_dummy_vm_close(struct vm_area_struct *vma)
+{
+	struct plat_dummy_device *my_device = vma->vm_private_data;
+
+	atomic_dec(&my_device->rx_maps);
+}
+
+static const struct vm_operations_struct plat_dummy_vm_ops = {
+	.open	= plat_dummy_vm_open,
+	.close	= plat_dummy_vm_close,
+};
+
+static void plat_dummy_tx_vm_open(struct vm_area_struct *vma)
+{
+	struct plat_dummy_device *my_device = vma->vm_private_data;
+
+	atomic_inc(&my_device->tx_maps);
+}
+
+static void plat_dummy_tx_vm_close(struct vm_area_struct *vma)
+{
+	struct plat_dummy_device *my_device = vma->vm_private_data;
+
+	atomic_dec(&my_device->tx_maps);
+}
+
+static const struct vm_operations_struct plat_dummy_tx_vm_ops = {
+	.open	= plat_dummy_tx_vm_open,
+	.close	= plat_dummy_tx_vm_close,
+};
+
+/*
+ * TX queue is mapped shared: ctrl page followed by the slots. The first
+ * mapping continues where write() stopped. mmap_sem is held here and
+ * writers fault with wr_mutex held, so it is only tried.
+ */
+static int plat_dummy_tx_mmap(struct plat_dummy_device *my_device,
+			      struct vm_area_struct *vma)
+{
+	unsigned long size = vma->vm_end - vma->vm_start;
+	bool published = false;
+	int ret;
+
+	if (!(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	if (size > PAGE_SIZE + PAGE_ALIGN(my_device->tx_slots * MEM_SIZE))
+		return -EINVAL;
+
+	if (!mutex_trylock(&my_device->wr_mutex))
+		return -EBUSY;
+
+	if (!atomic_read(&my_device->tx_maps)) {
+		/* a previous mapping may have left frames */
+		plat_dummy_tx_sync(my_device);
+		if (my_device->tx_fill) {
+			plat_dummy_tx_publish(my_device);
+			published = true;
+		}
+		WRITE_ONCE(my_device->tx_ctrl->head, my_device->tx_head);
+	}
+	ret = remap_vmalloc_range_partial(vma, vma->vm_start,
+					  my_device->tx_ctrl, PAGE_SIZE);
+	if (!ret && size > PAGE_SIZE)
+		ret = remap_vmalloc_range_partial(vma,
+						  vma->vm_start + PAGE_SIZE,
+						  my_device->tx_buf,
+						  size - PAGE_SIZE);
+	if (!ret) {
+		vma->vm_ops = &plat_dummy_tx_vm_ops;
+		vma->vm_private_data = my_device;
+		plat_dummy_tx_vm_open(vma);
+	}
+	mutex_unlock(&my_device->wr_mutex);
+	if (published)
+		plat_dummy_kick(my_device);
+
+	return ret;
+}
+
+/*DUMMY_TX_DOORBELL: mmap() producer committed frames, don't wait for a poll*/
+static int plat_dummy_tx_doorbell(struct plat_dummy_device *my_device)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	if (!atomic_read(&my_device->tx_maps))
+		return -EINVAL;
+
+	plat_dummy_kick(my_device);
+	return 0;
+}
+
+/*RX ring is mapped read-only: ctrl page followed by the data pages*/
+static int plat_dummy_mmap(struct plat_dummy_device *my_device,
+			   struct vm_area_struct *vma)
+{
+	unsigned long size = vma->vm_end - vma->vm_start;
+	int ret;
+
+	if (!my_device)
+		return -EFAULT;
+
+	if (vma->vm_pgoff == DUMMY_TX_MMAP_OFFSET >> PAGE_SHIFT)
+		return plat_dummy_tx_mmap(my_device, vma);
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	if (vma->vm_pgoff || size > PAGE_SIZE + my_device->buffersize)
+		return -EINVAL;
+
+	/* resize replaces the data area only, so the two are mapped apart.
+	 * mmap_sem is held here and readers fault with rd_mutex held. */
+	if (!mutex_trylock(&my_device->rd_mutex))
+		return -EBUSY;
+	ret = remap_vmalloc_range_partial(vma, vma->vm_start,
+					  my_device->ring_ctrl, PAGE_SIZE);
+	if (!ret && size > PAGE_SIZE)
+		ret = remap_vmalloc_range_partial(vma,
+						  vma->vm_start + PAGE_SIZE,
+						  my_device->buffer,
+						  size - PAGE_SIZE);
+	if (!ret) {
+		vma->vm_ops = &plat_dummy_vm_ops;
+		vma->vm_private_data = my_device;
+		plat_dummy_vm_open(vma);
+	}
+	mutex_unlock(&my_device->rd_mutex);
+
+	return ret;
+}
+
+/*intervals in ms*/
+#define MIN_PULL_INTERVAL 10
+#define MAX_PULL_INTERVAL 10000
+/*hrtimer intervals in us*/
+#define MIN_PULL_INTERVAL_US 50
+#define MAX_PULL_INTERVAL_US 10000000
+#define MAX_PULL_BACKOFF 16
+
+int set_poll_interval(struct plat_dummy_device *my_device, u32 ms_interval)
+{
+	pr_info("++%s(%p)\n", __func__, my_device);
+	if (!my_device)
+		return -EFAULT;
+
+	if ((ms_interval < MIN_PULL_INTERVAL) 
+	    || (ms_interval > MAX_PULL_INTERVAL)) {
+
+		pr_err("%s: Value out of range %d\n", __func__, ms_interval);
+		return -EFAULT;
+	}
+	mutex_lock(&my_device->cfg_mutex);
+	spin_lock(&my_device->pool_lock);
+	my_device->js_pool_time = msecs_to_jiffies(ms_interval);
+	my_device->js_pool_cur = my_device->js_pool_time;
+	if (my_device->js_pool_max < my_device->js_pool_time)
+		my_device->js_pool_max = my_device->js_pool_time;
+	spin_unlock(&my_device->pool_lock);
+	if (my_device->hr_poll) {
+		/* back to jiffies based polling */
+		WRITE_ONCE(my_device->hr_poll, false);
+		hrtimer_cancel(&my_device->poll_timer);
+		if (!plat_dummy_irq_mode(my_device))
+			plat_dummy_queue_work(my_device, my_device->js_pool_time);
+	}
+	mutex_unlock(&my_device->cfg_mutex);
+	pr_info("%s: Setting Poliing Interval to %d ms\n", __func__, ms_interval);
+	return 0;
+}
+
+/*Poll from an hrtimer for intervals finer than a jiffy*/
+static int set_poll_interval_us(struct plat_dummy_device *my_device,
+				u32 us_interval)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	if ((us_interval < MIN_PULL_INTERVAL_US)
+	    || (us_interval > MAX_PULL_INTERVAL_US)) {
+		pr_err("%s: Value out of range %u\n", __func__, us_interval);
+		return -EINVAL;
+	}
+
+	if (plat_dummy_irq_mode(my_device)) {
+		pr_err("%s: Device is interrupt driven\n", __func__);
+		return -EINVAL;
+	}
+
+	mutex_lock(&my_device->cfg_mutex);
+	my_device->hr_interval = ns_to_ktime((u64)us_interval * NSEC_PER_USEC);
+	WRITE_ONCE(my_device->hr_poll, true);
+	/* a backed off jiffies pass would keep the timer from queueing us */
+	plat_dummy_mod_work(my_device, 0);
+	hrtimer_start(&my_device->poll_timer, my_device->hr_interval,
+		      HRTIMER_MODE_REL);
+	mutex_unlock(&my_device->cfg_mutex);
+	pr_info("%s: Setting Polling Interval to %u us\n", __func__,
+		us_interval);
+	return 0;
+}
+
+/*Idle backoff: interval grows by factor up to max_ms, factor 1 disables it*/
+static int set_poll_backoff(struct plat_dummy_device *my_device,
+			    const struct dummy_backoff *cfg)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	if ((cfg->min_ms < MIN_PULL_INTERVAL)
+	    || (cfg->max_ms > MAX_PULL_INTERVAL)
+	    || (cfg->min_ms > cfg->max_ms)
+	    || (cfg->factor < 1) || (cfg->factor > MAX_PULL_BACKOFF)) {
+		pr_err("%s: Value out of range %u/%u/%u\n", __func__,
+		       cfg->min_ms, cfg->max_ms, cfg->factor);
+		return -EINVAL;
+	}
+
+	spin_lock(&my_device->pool_lock);
+	my_device->js_pool_time = msecs_to_jiffies(cfg->min_ms);
+	my_device->js_pool_max = msecs_to_jiffies(cfg->max_ms);
+	my_device->js_pool_cur = my_device->js_pool_time;
+	my_device->pool_backoff = cfg->factor;
+	spin_unlock(&my_device->pool_lock);
+	return 0;
+}
+
+/*Interval the poller is really using now, 0 for interrupt mode*/
+static int get_poll_interval_us(struct plat_dummy_device *my_device,
+				u32 *us_interval)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	if (plat_dummy_irq_mode(my_device)) {
+		*us_interval = 0;
+	} else if (READ_ONCE(my_device->hr_poll)) {
+		*us_interval = ktime_to_us(my_device->hr_interval);
+	} else {
+		spin_lock(&my_device->pool_lock);
+		*us_interval = jiffies_to_usecs(my_device->js_pool_cur);
+		spin_unlock(&my_device->pool_lock);
+	}
+	return 0;
+}
+
+/*Grow the interval while idle, snap back to js_pool_time on traffic*/
+static u64 plat_dummy_next_interval(struct plat_dummy_device *my_device,
+				    enum plat_poll_result res)
+{
+	u64 js_time;
+
+	spin_lock(&my_device->pool_lock);
+	if (res != PLAT_POLL_IDLE || plat_dummy_tx_depth(my_device))
+		my_device->js_pool_cur = my_device->js_pool_time;
+	else
+		my_device->js_pool_cur = min(my_device->js_pool_cur *
+					     my_device->pool_backoff,
+					     my_device->js_pool_max);
+	js_time = my_device->js_pool_cur;
+	spin_unlock(&my_device->pool_lock);
+
+	return js_time;
+}
+
+static int set_rx_policy(struct plat_dummy_device *my_device, u32 policy)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	if (policy > DUMMY_RX_DROP_OLDEST) {
+		pr_err("%s: Unknown policy %u\n", __func__, policy);
+		return -EINVAL;
+	}
+
+	WRITE_ONCE(my_device->rx_policy, policy);
+	return 0;
+}
+
+static int get_rx_drops(struct plat_dummy_device *my_device,
+			struct dummy_rx_drops *drops)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	drops->overruns = READ_ONCE(my_device->rx_overruns);
+	drops->dropped_bytes = READ_ONCE(my_device->rx_dropped);
+	return 0;
+}
+
+/*Snapshot of the counters; they are not sampled atomically as a set*/
+static int get_stats(struct plat_dummy_device *my_device,
+		     struct dummy_stats *stats)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	stats->rx_bytes = READ_ONCE(my_device->rx_bytes);
+	stats->rx_frames = READ_ONCE(my_device->rx_xfers);
+	stats->tx_bytes = READ_ONCE(my_device->tx_bytes);
+	stats->tx_frames = READ_ONCE(my_device->tx_xfers);
+	stats->poll_cycles = READ_ONCE(my_device->poll_cycles);
+	stats->empty_polls = READ_ONCE(my_device->empty_polls);
+	stats->ring_hwm = READ_ONCE(my_device->ring_hwm);
+	stats->rx_overruns = READ_ONCE(my_device->rx_overruns);
+	stats->rx_dropped = READ_ONCE(my_device->rx_dropped);
+	stats->reader_sleeps = READ_ONCE(my_device->rd_sleeps);
+	stats->writer_sleeps = READ_ONCE(my_device->tx_stalls);
+	stats->rd_contended = READ_ONCE(my_device->rd_contended);
+	stats->wr_contended = READ_ONCE(my_device->wr_contended);
+	stats->timer_overruns = READ_ONCE(my_device->hr_overruns);
+	stats->rx_xfer_cycles = READ_ONCE(my_device->rx_xfer_cycles);
+	stats->tx_xfer_cycles = READ_ONCE(my_device->tx_xfer_cycles);
+	return 0;
+}
+
+static int get_poll_overruns(struct plat_dummy_device *my_device,
+			     u64 *overruns)
+{
+	if (!my_device)
+		return -EFAULT;
+
+	*overruns = READ_ONCE(my_device->hr_overruns);
+	return 0;
+}
+
+static enum hrtimer_restart plat_dummy_hr_poll(struct hrtimer *timer)
+{
+	struct plat_dummy_device *my_device;
+	u64 missed;
+
+	my_device = container_of(timer, struct plat_dummy_device, poll_timer);
+
+	/* previous pass still not started: the poller can't keep up */
+	if (!plat_dummy_queue_work(my_device, 0))
+		my_device->hr_overruns++;
+
+	missed = hrtimer_forward_now(timer, my_device->hr_interval);
+	if (missed > 1)
+		my_device->hr_overruns += missed - 1;
+
+	return HRTIMER_RESTART;
+}
+
+enum plat_rx_verdict {
+	PLAT_RX_STORE,		/* there is room for the frame */
+	PLAT_RX_DROP,		/* ack the frame, don't store it */
+	PLAT_RX_STALL,		/* leave it in the device for now */
+};
+
+/*
+ * Broadcast readers more than rx_evict_lag bytes behind lose their place
+ * so the others can go on. True if there is room for the frame now.
+ */
+static bool plat_dummy_rx_evict(struct plat_dummy_device *my_dev, u32 size)
+{
+	struct plat_dummy_reader *reader;
+	u32 head, evict_lag = READ_ONCE(my_dev->rx_evict_lag);
+	bool active = false;
+
+	if (!evict_lag || !READ_ONCE(my_dev->nr_readers))
+		return false;
+
+	if (!mutex_trylock(&my_dev->rd_mutex))
+		return false;
+
+	head = my_dev->ring_ctrl->head;
+	list_for_each_entry(reader, &my_dev->readers, node) {
+		if (!reader->evicted && head - reader->pos > evict_lag) {
+			WRITE_ONCE(reader->evicted, true);
+			dev_dbg(&my_dev->pdev->dev, "reader evicted, lag %u\n",
+				head - reader->pos);
+		}
+		active |= !reader->evicted;
+	}
+	if (active)
+		plat_dummy_readers_tail(my_dev);
+	else
+		smp_store_release(&my_dev->ring_ctrl->tail, head);
+	mutex_unlock(&my_dev->rd_mutex);
+	wake_up_interruptible(&my_dev->rwq);
+
+	return plat_dummy_rx_free(my_dev) >= size;
+}
+
+/*Readers which still point at data dropped from the ring skip it*/
+static void plat_dummy_readers_skip(struct plat_dummy_device *my_dev,
+				    u32 new_tail)
+{
+	struct plat_dummy_reader *reader;
+
+	list_for_each_entry(reader, &my_dev->readers, node) {
+		if ((s32)(new_tail - reader->pos) > 0) {
+			reader->dropped += new_tail - reader->pos;
+			reader->pos = new_tail;
+		}
+	}
+}
+
+/*No room for a frame of size bytes: rx_policy decides what to do*/
+static enum plat_rx_verdict plat_dummy_rx_overflow(struct plat_dummy_device *my_dev,
+						   u32 size)
+{
+	u32 tail, new_tail;
+
+	if (plat_dummy_rx_evict(my_dev, size))
+		return PLAT_RX_STORE;
+
+	switch (READ_ONCE(my_dev->rx_policy)) {
+	case DUMMY_RX_DROP_NEWEST:
+		my_dev->rx_overruns++;
+		my_dev->rx_dropped += size;
+		return PLAT_RX_DROP;
+
+	case DUMMY_RX_DROP_OLDEST:
+		/* a reader in the middle of a copy frees space anyway */
+		if (!mutex_trylock(&my_dev->rd_mutex))
+			return PLAT_RX_STALL;
+
+		tail = my_dev->ring_ctrl->tail;
+		new_tail = my_dev->ring_ctrl->head + size - my_dev->buffersize;
+		if ((s32)(new_tail - tail) > 0) {
+			my_dev->rx_dropped += new_tail - tail;
+			plat_dummy_readers_skip(my_dev, new_tail);
+			smp_store_release(&my_dev->ring_ctrl->tail, new_tail);
+		}
+		mutex_unlock(&my_dev->rd_mutex);
+		my_dev->rx_overruns++;
+		return PLAT_RX_STORE;
+
+	default:
+		/* count the frame once, not every pass it waits */
+		if (!my_dev->rx_stalled) {
+			my_dev->rx_stalled = true;
+			my_dev->rx_overruns++;
+		}
+		return PLAT_RX_STALL;
+	}
+}
+
+/*Copy a frame of size bytes from the device window into the ring*/
+static void plat_dummy_rx_store(struct plat_dummy_device *my_device, u32 size)
+{
+	u32 head, off, first, used;
+	cycles_t t0, t1;
+
+	/* callers made room, anything else would overwrite unread data */
+	if (WARN_ON_ONCE(plat_dummy_rx_free(my_device) < size))
+		return;
+
+	/* at most two segments: up to the ring end and from its start */
+	head = my_device->ring_ctrl->head;
+	first = plat_dummy_ring_split(my_device, head, size, &off);
+	t0 = get_cycles();
+	plat_dummy_mem_read(my_device, my_device->buffer + off, 0, first);
+	if (size > first)
+		plat_dummy_mem_read(my_device, my_device->buffer, first,
+				    size - first);
+	t1 = get_cycles();
+	my_device->rx_xfers++;
+	my_device->rx_bytes += size;
+	my_device->rx_xfer_cycles += t1 - t0;
+	dev_dbg(&my_device->pdev->dev, "rx %u bytes: %llu cycles\n",
+		size, (u64)(t1 - t0));
+
+	trace_plat_dummy_rx_push(my_device->id, head, size);
+
+	used = head + size - READ_ONCE(my_device->ring_ctrl->tail);
+	if (used > my_device->ring_hwm)
+		my_device->ring_hwm = used;
+
+	/* keep the frame boundary for framed readers */
+	plat_dummy_ring_commit(my_device, head, size, my_device->rx_seen_ns,
+			       plat_dummy_ts(my_device));
+	wake_up_interruptible(&my_device->rwq);
+}
+
+/*
+ * Emulator: without real hardware (emulate=1) the window and registers
+ * live in kernel memory and this plays the device side of the protocol.
+ * It steps whenever either engine looks at the window, under win_mutex,
+ * so it never races the host side. Generated frames start with struct
+ * dummy_emu_hdr, a token bucket keeps them to emu_rate frames/s with up
+ * to emu_burst back to back. In interrupt mode a timer, every state
+ * change and host TX raise the "interrupt"; the timer keeps raising it
+ * while a host frame or its echo waits for a step.
+ */
+static bool emulate;
+module_param(emulate, bool, 0444);
+MODULE_PARM_DESC(emulate, "Devices created without DT are emulated in memory");
+
+static unsigned int emu_frame_size = 1024;
+module_param(emu_frame_size, uint, 0644);
+MODULE_PARM_DESC(emu_frame_size, "Emulator: generated frame size in bytes");
+
+static unsigned int emu_rate;
+module_param(emu_rate, uint, 0644);
+MODULE_PARM_DESC(emu_rate, "Emulator: generated frames per second, 0 for none");
+
+static unsigned int emu_burst = 1;
+module_param(emu_burst, uint, 0644);
+MODULE_PARM_DESC(emu_burst, "Emulator: frames which may be generated back to back");
+
+static bool emu_loopback;
+module_param(emu_loopback, bool, 0644);
+MODULE_PARM_DESC(emu_loopback, "Emulator: frames written by the host come back as RX");
+
+#define EMU_MIN_PERIOD_NS	(20 * NSEC_PER_USEC)
+#define EMU_IDLE_PERIOD_NS	(10 * NSEC_PER_MSEC)
+
+struct plat_dummy_emu {
+	struct plat_dummy_device *my_device;
+	struct hrtimer timer;		/* interrupt mode: raises the irq */
+	struct work_struct irq_work;
+	u64 credit;			/* NSEC_PER_SEC per frame */
+	u64 last_ns;
+	u32 seq;
+	bool pending_rx;		/* DATA_READY is ours, not host TX */
+	bool echo;			/* loopback frame goes out next step */
+};
+
+static void plat_dummy_emu_step(struct plat_dummy_device *my_device)
+{
+	struct plat_dummy_emu *emu = my_device->emu;
+	u32 status, old, size, rate, burst;
+	struct dummy_emu_hdr hdr;
+	bool took = false;
+	u64 now;
+
+	status = old = plat_dummy_reg_read32(my_device, PLAT_IO_FLAG_REG);
+
+	if (emu->echo) {
+		/* window still holds the host frame, hand it back as RX */
+		status |= PLAT_IO_DATA_READY;
+		emu->pending_rx = true;
+		WRITE_ONCE(emu->echo, false);
+	} else if (status & PLAT_IO_DATA_READY) {
+		if (!emu->pending_rx) {
+			/* host wrote a frame: take it and say so */
+			status &= ~PLAT_IO_DATA_READY;
+			status |= PLAT_TX_DONE;
+			WRITE_ONCE(emu->echo, READ_ONCE(emu_loopback));
+			took = true;
+		}
+	} else {
+		emu->pending_rx = false;	/* host took our frame */
+	}
+
+	now = ktime_get_ns();
+	rate = READ_ONCE(emu_rate);
+	burst = max(READ_ONCE(emu_burst), 1U);
+	emu->credit = min(emu->credit + (now - emu->last_ns) * rate,
+			  (u64)burst * NSEC_PER_SEC);
+	emu->last_ns = now;
+
+	/* the TX ack is a step of its own, RX comes on the next one */
+	if (!took && !emu->echo && !(status & PLAT_IO_DATA_READY) &&
+	    emu->credit >= NSEC_PER_SEC &&
+	    !((status & PLAT_WRITE_READY) && plat_dummy_tx_depth(my_device))) {
+		size = clamp_t(u32, READ_ONCE(emu_frame_size), sizeof(hdr),
+			       MEM_SIZE);
+		hdr.magic = DUMMY_EMU_MAGIC;
+		hdr.seq = emu->seq++;
+		hdr.ts_ns = now;
+		plat_dummy_mem_write(my_device, 0, &hdr, sizeof(hdr));
+		plat_dummy_reg_write32(my_device, PLAT_IO_SIZE_REG, size);
+		/* no TX grant while our frame is in the window, the ack sets it */
+		status &= ~PLAT_WRITE_READY;
+		status |= PLAT_IO_DATA_READY;
+		emu->pending_rx = true;
+		emu->credit -= NSEC_PER_SEC;
+	} else if (!emu->echo &&
+		   !(status & (PLAT_IO_DATA_READY | PLAT_WRITE_READY))) {
+		status |= PLAT_WRITE_READY;	/* ready for host TX */
+	}
+
+	if (status != old) {
+		plat_dummy_reg_write32(my_device, PLAT_IO_FLAG_REG, status);
+		/* real hardware raises its interrupt here */
+		if (plat_dummy_irq_mode(my_device))
+			schedule_work(&emu->irq_work);
+	}
+}
+
+/*The emulator has a step to take without the host touching the window*/
+static bool plat_dummy_emu_pending(struct plat_dummy_device *my_device)
+{
+	struct plat_dummy_emu *emu = my_device->emu;
+
+	if (!emu)
+		return false;
+	/* host frame not taken yet or its echo not posted */
+	return READ_ONCE(emu->echo) ||
+	       (READ_ONCE(my_device->tx_busy) &&
+		(plat_dummy_reg_read32(my_device, PLAT_IO_FLAG_REG) &
+		 PLAT_IO_DATA_READY));
+}
 
-#define PLAT_IO_FLAG_REG		(0) /*Offset of flag register*/
-#define PLAT_IO_SIZE_REG		(4) /*Offset of flag register*/
-#define PLAT_IO_DATA_READY		(1) /*IO data ready flag */
-#define PLAT_WRITE_READY		(1 << 1)
-#define MAX_DUMMY_PLAT_THREADS		(1) /*Maximum amount of threads for this */
+/*Raise the emulated interrupt, nothing else steps a device in irq mode*/
+static void plat_dummy_emu_raise(struct plat_dummy_device *my_device)
+{
+	if (my_device->emu && plat_dummy_irq_mode(my_device))
+		schedule_work(&my_device->emu->irq_work);
+}
 
+static void plat_dummy_emu_irq(struct work_struct *work)
+{
+	struct plat_dummy_emu *emu = container_of(work, struct plat_dummy_emu,
+						  irq_work);
 
-/*Device has 2 resources:
- * * 1) 4K of memory at address defined by dts - used for data transfer;
- * * 2) Two 32-bit registers at address (defined by dts)
- * *  2.1. Flag Register: @offset 0
- * *	bit 0: PLAT_IO_DATA_READY - set to 1 if data from device ready
- * *	other bits: reserved;
- * * 2.2. Data size Register @offset 4: - Contain data size from device
- * (0..4095);
- * */
+	plat_dummy_napi_schedule(emu->my_device);
+}
 
-/*Following has to be added to dts file to support it
- * *aliases {
- * *		dummy0 = &my_dummy1;
- * *		dummy1 = &my_dummy2;
- * *};
- * *
- * *my_dummy1: dummy@9f200000 {
- * *		compatible = "ti,plat_dummy";
- * *		reg = <0x9f200000 0x1000>,
- * *				<0x9f201000 0x8>;
- * *};
- * *
- * *my_dummy2: dummy@9f210000 {
- * *		compatible = "ti,plat_dummy";
- * *		reg = <0x9f210000 0x1000>,
- * *				<0x9f211000 0x8>;
- * *};
- * *
- * */
-#define MEM_BASE_1	(0x88000000)
-#define REG_BASE_1	(0x88001000)
+static u64 plat_dummy_emu_period(void)
+{
+	u32 rate = READ_ONCE(emu_rate);
 
-#define MEM_BASE_2	(0x88010000)
-#define REG_BASE_2	(0x88011000)
+	if (!rate)
+		return EMU_IDLE_PERIOD_NS;
+	return max_t(u64, NSEC_PER_SEC / rate, EMU_MIN_PERIOD_NS);
+}
 
-struct platform_device *pdev;
+static enum hrtimer_restart plat_dummy_emu_timer(struct hrtimer *timer)
+{
+	struct plat_dummy_emu *emu = container_of(timer, struct plat_dummy_emu,
+						  timer);
 
-struct resource res_1[2] = {
-	{
-	.start	= MEM_BASE_1,
-	.end	= MEM_BASE_1 + MEM_SIZE - 1,
-	.name	= "dummy_mem_1",
-	.flags	= IORESOURCE_MEM,
-	},
+	if (READ_ONCE(emu_rate) || plat_dummy_emu_pending(emu->my_device))
+		schedule_work(&emu->irq_work);
+	hrtimer_forward_now(timer, ns_to_ktime(plat_dummy_emu_period()));
+	return HRTIMER_RESTART;
+}
 
-	{
-	.start	= REG_BASE_1,
-	.end	= REG_BASE_1 + REG_SIZE - 1,
-	.name	= "dummy_regs_1",
-	.flags	= IORESOURCE_MEM,
-	}
-};
+static int plat_dummy_emu_init(struct plat_dummy_device *my_device)
+{
+	struct device *dev = &my_device->pdev->dev;
+	struct plat_dummy_emu *emu;
+	void *mem, *regs;
+
+	emu = devm_kzalloc(dev, sizeof(*emu), GFP_KERNEL);
+	mem = devm_kzalloc(dev, MEM_SIZE, GFP_KERNEL);
+	regs = devm_kzalloc(dev, REG_SIZE, GFP_KERNEL);
+	if (!emu || !mem || !regs)
+		return -ENOMEM;
 
-struct resource res_2[2] = {
-	{
-	.start	= MEM_BASE_2,
-	.end	= MEM_BASE_2 + MEM_SIZE - 1,
-	.name	= "dummy_mem_2",
-	.flags	= IORESOURCE_MEM,
-	},
+	emu->my_device = my_device;
+	emu->last_ns = ktime_get_ns();
+	hrtimer_init(&emu->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	emu->timer.function = plat_dummy_emu_timer;
+	INIT_WORK(&emu->irq_work, plat_dummy_emu_irq);
 
-	{
-	.start	= REG_BASE_2,
-	.end	= REG_BASE_2 + REG_SIZE - 1,
-	.name	= "dummy_regs_2",
-	.flags	= IORESOURCE_MEM,
-	}
-};
+	my_device->mem = (void __force __iomem *)mem;
+	my_device->regs = (void __force __iomem *)regs;
+	my_device->emu = emu;
+	dev_info(dev, "emulated device\n");
+	return 0;
+}
 
-static struct plat_dummy_device *mydevs[DUMMY_DEVICES];
+/*Polled devices see the emulator on every pass, others need the timer*/
+static void plat_dummy_emu_start(struct plat_dummy_device *my_device)
+{
+	if (my_device->emu && plat_dummy_irq_mode(my_device))
+		hrtimer_start(&my_device->emu->timer,
+			      ns_to_ktime(plat_dummy_emu_period()),
+			      HRTIMER_MODE_REL);
+}
 
-static u32 plat_dummy_mem_read8(struct plat_dummy_device *my_dev, u32 offset)
+static void plat_dummy_emu_stop(struct plat_dummy_device *my_device)
 {
-	return ioread8(my_dev->mem + offset);
+	if (!my_device->emu)
+		return;
+
+	hrtimer_cancel(&my_device->emu->timer);
+	cancel_work_sync(&my_device->emu->irq_work);
 }
 
-static u32 plat_dummy_mem_write8(struct plat_dummy_device *my_dev, u32 offset,
-				 u32 val)
+/*
+ * Flag register after the device had its say, see the register protocol
+ * in platform_ring.h. The RX engine (poll work) and the TX engine
+ * (tx_work) each take win_mutex for one frame only, so neither waits for
+ * a pass of the other.
+ */
+static u32 plat_dummy_win_status(struct plat_dummy_device *my_device)
 {
-	iowrite8(val, my_dev->mem + offset);
-	return 0;
+	u32 status, acked;
+
+	if (my_device->emu)
+		plat_dummy_emu_step(my_device);
+
+	status = plat_dummy_reg_read32(my_device, PLAT_IO_FLAG_REG);
+	acked = plat_dummy_tx_complete(my_device, status);
+	if (acked != status)
+		plat_dummy_reg_write32(my_device, PLAT_IO_FLAG_REG, acked);
+	return acked;
 }
 
-static u32 plat_dummy_reg_read32(struct plat_dummy_device *my_dev, u32 offset)
+/*One frame from the TX queue into the window, false if none went*/
+static bool plat_dummy_tx_once(struct plat_dummy_device *my_device)
 {
-	return ioread32(my_dev->regs + offset);
+	u32 status, tail, len;
+	cycles_t t0, t1;
+
+	/* pairs with the release in plat_dummy_tx_publish() */
+	tail = my_device->tx_tail;
+	if (smp_load_acquire(&my_device->tx_head) == tail) {
+		/* the mmap() head equals ours unless there is something new */
+		if (READ_ONCE(my_device->tx_ctrl->head) == tail)
+			return false;
+		mutex_lock(&my_device->wr_mutex);
+		plat_dummy_tx_sync(my_device);
+		mutex_unlock(&my_device->wr_mutex);
+		if (my_device->tx_head == tail)
+			return false;
+	}
+	len = my_device->tx_len[tail & (my_device->tx_slots - 1)];
+
+	mutex_lock(&my_device->win_mutex);
+	status = plat_dummy_win_status(my_device);
+	if (!plat_dummy_win_free(status)) {
+		/* RX frame or our last one in there: whoever frees it kicks us */
+		mutex_unlock(&my_device->win_mutex);
+		return false;
+	}
+
+	/* push only what the writer gave us */
+	t0 = get_cycles();
+	plat_dummy_mem_write(my_device, 0, plat_dummy_tx_slot(my_device, tail),
+			     len);
+	t1 = get_cycles();
+	plat_dummy_reg_write32(my_device, PLAT_IO_SIZE_REG, len);
+	status = plat_dummy_tx_post(my_device, status);
+	plat_dummy_reg_write32(my_device, PLAT_IO_FLAG_REG, status);
+	mutex_unlock(&my_device->win_mutex);
+
+	/* no interrupt when it's taken, the poller watches the window */
+	if (!my_device->has_tx_done && plat_dummy_irq_mode(my_device))
+		plat_dummy_napi_schedule(my_device);
+	plat_dummy_emu_raise(my_device);
+
+	my_device->tx_xfers++;
+	my_device->tx_bytes += len;
+	my_device->tx_xfer_cycles += t1 - t0;
+	dev_dbg(&my_device->pdev->dev, "tx %u bytes: %llu cycles\n",
+		len, (u64)(t1 - t0));
+	trace_plat_dummy_tx_flush(my_device->id, tail, len);
+
+	plat_dummy_tx_consume(my_device);
+	wake_up_interruptible(&my_device->wwq);
+	return true;
 }
-static void plat_dummy_reg_write32(struct plat_dummy_device *my_dev, u32 offset
-				   , u32 val)
+
+/*TX engine: sends for as long as the device takes frames*/
+static void plat_dummy_tx_work(struct work_struct *work)
 {
-	iowrite32(val, my_dev->regs + offset);
+	struct plat_dummy_device *my_device;
+	u64 tx_bytes;
+	int done;
+
+	my_device = container_of(work, struct plat_dummy_device, tx_work);
+	tx_bytes = my_device->tx_bytes;
+
+	for (done = 0; done < PLAT_NAPI_BUDGET; done++)
+		if (!plat_dummy_tx_once(my_device))
+			break;
+
+	/* tx_bytes only moves in here, the work doesn't run twice at once */
+	trace_plat_dummy_tx_work(my_device->id, done,
+				 my_device->tx_bytes - tx_bytes);
+
+	/* still going: let the others run first */
+	if (done == PLAT_NAPI_BUDGET)
+		plat_dummy_tx_kick(my_device);
 }
 
-/* How much space is free? */
-static int spacefree(struct plat_dummy_device *my_dev)
+/*Queue the TX engine unless the device is being stopped*/
+static void plat_dummy_tx_kick(struct plat_dummy_device *my_device)
 {
-	if (my_dev->rp == my_dev->wp)
-		return my_dev->buffersize - 1;
-		return ((my_dev->rp + my_dev->buffersize - my_dev->wp) %
-							my_dev->buffersize) - 1;
+	spin_lock(&my_device->pool_lock);
+	if (!my_device->paused)
+		queue_work(my_device->data_read_wq, &my_device->tx_work);
+	spin_unlock(&my_device->pool_lock);
 }
 
-static ssize_t plat_dummy_read(struct plat_dummy_device *my_device,
-			       char __user *buf, size_t count)
+/*RX engine: one pass over the window, TX frames are left to tx_work*/
+static enum plat_poll_result plat_dummy_poll_once(struct plat_dummy_device *my_device)
 {
-	if (!my_device)
-		return -EFAULT;
+	u32 size, status;
+	enum plat_rx_verdict verdict;
+	enum plat_poll_result ret = PLAT_POLL_IDLE;
+
+	my_device->poll_cycles++;
+	mutex_lock(&my_device->win_mutex);
+	status = plat_dummy_win_status(my_device);
+
+	if (plat_dummy_rx_pending(my_device, status)) {
+		/* a stalled frame keeps the time it was first seen */
+		if (!my_device->rx_seen_ns)
+			my_device->rx_seen_ns = plat_dummy_ts(my_device);
+		size = plat_dummy_reg_read32(my_device, PLAT_IO_SIZE_REG);
 
-	if (mutex_lock_interruptible(&my_device->rd_mutex))
-		return -ERESTARTSYS;
+		if (size > MEM_SIZE)
+			size = MEM_SIZE;
 
-//	pr_info("++%s: my_device->rp = %p, my_device->wp = %p\n", __func__,
-//		my_device->rp, my_device->wp);
+		verdict = PLAT_RX_STORE;
+		if (plat_dummy_rx_free(my_device) < size)
+			verdict = plat_dummy_rx_overflow(my_device, size);
 
-	while (my_device->rp == my_device->wp) { /* nothing to read */
-		mutex_unlock(&my_device->rd_mutex); /* release the lock */
-//		pr_info("\"%s\" reading: going to sleep\n", current->comm);
-		if (wait_event_interruptible(my_device->rwq,
-					     (my_device->rp != my_device->wp)))
-			return -ERESTARTSYS;	/* signal: tell the fs layer to handle it */
-		/* otherwise loop, but first reacquire the lock */
-		if (mutex_lock_interruptible(&my_device->rd_mutex))
-			return -ERESTARTSYS;
-	}
-	/* ok, data is there, return something */
-//	pr_info("count = %zu, my_device->rp = %p, my_device->wp = %p\n", count,
-//		my_device->rp, my_device->wp);
+		if (verdict == PLAT_RX_STALL) {
+			mutex_unlock(&my_device->win_mutex);
+			return PLAT_POLL_STALLED;
+		}
 
-	if (my_device->wp > my_device->rp)
-		count = min(count, (size_t)(my_device->wp - my_device->rp));
-	else /* the write pointer has wrapped, return data up to dev->end */
-		count = min(count, (size_t)(my_device->end - my_device->rp));
+		my_device->rx_stalled = false;
+		if (verdict == PLAT_RX_STORE)
+			plat_dummy_rx_store(my_device, size);
+		my_device->rx_seen_ns = 0;
 
-	if (copy_to_user(buf, my_device->rp, count)) {
-		mutex_unlock (&my_device->rd_mutex);
-		return -EFAULT;
+		rmb();
+		status = plat_dummy_rx_release(status);
+		plat_dummy_reg_write32(my_device, PLAT_IO_FLAG_REG, status);
+		ret = PLAT_POLL_BUSY;
 	}
+	mutex_unlock(&my_device->win_mutex);
 
-	my_device->rp += count;
-	if (my_device->rp == my_device->end)
-		my_device->rp = my_device->buffer; /* wrapped */
-	mutex_unlock (&my_device->rd_mutex);
+	/* the TX engine doesn't poll, the device's grant is seen here */
+	if (plat_dummy_tx_ready(my_device, status))
+		plat_dummy_tx_kick(my_device);
 
-	pr_info("\"%s\" did read %li bytes\n",current->comm, (long)count);
-	return count;
+	if (ret == PLAT_POLL_IDLE)
+		my_device->empty_polls++;
+	return ret;
 }
 
-static ssize_t plat_dummy_write(struct plat_dummy_device *my_device,
-				const char __user *buf, size_t count)
+/*
+ * NAPI like switch from interrupts to polling: the line stays disabled
+ * while the budgeted poller runs, the poller enables it once drained.
+ */
+static void plat_dummy_napi_schedule(struct plat_dummy_device *my_device)
 {
-	int volume, n;
+	spin_lock(&my_device->pool_lock);
+	if (!my_device->paused &&
+	    !test_and_set_bit(PLAT_NAPI_SCHED, &my_device->napi_state)) {
+		if (my_device->irq > 0)
+			disable_irq_nosync(my_device->irq);
+		plat_dummy_queue_work(my_device, 0);
+	}
+	spin_unlock(&my_device->pool_lock);
+}
 
-	if (!my_device)
-		return -EFAULT;
+static void plat_dummy_napi_complete(struct plat_dummy_device *my_device)
+{
+	u32 status;
 
-	if (mutex_lock_interruptible(&my_device->rd_mutex))
-		return -ERESTARTSYS;
+	clear_bit(PLAT_NAPI_SCHED, &my_device->napi_state);
+	smp_mb__after_atomic();
+	if (my_device->irq > 0)
+		enable_irq(my_device->irq);
 
-	if (my_device->bw_status) {
-		mutex_unlock(&my_device->rd_mutex);
-		wait_event_interruptible(my_device->wwq, !(my_device->bw_status));
-		if(mutex_lock_interruptible(&my_device->rd_mutex))
-			return -ERESTARTSYS;
-	}
+	/* software interrupts raised while we were polling are lost */
+	status = plat_dummy_reg_read32(my_device, PLAT_IO_FLAG_REG);
+	if (plat_dummy_rx_pending(my_device, status) ||
+	    plat_dummy_emu_pending(my_device))
+		plat_dummy_napi_schedule(my_device);
+}
 
-	volume = min((int)MEM_SIZE, (int)count);
-	n = copy_from_user(my_device->buffer_w, buf, volume);
-	my_device->bw_status = 1;
-	my_device->bw_size_copied = volume - n;
-	mutex_unlock(&my_device->rd_mutex);
+static irqreturn_t plat_dummy_isr(int irq, void *data)
+{
+	struct plat_dummy_device *my_device = data;
+	u32 status;
+
+	status = plat_dummy_reg_read32(my_device, PLAT_IO_FLAG_REG);
+	if (!plat_dummy_irq_pending(my_device, status))
+		return IRQ_NONE;
 
-	return volume - n;
+	return IRQ_WAKE_THREAD;
 }
 
-/*intervals in ms*/
-#define MIN_PULL_INTERVAL 10
-#define MAX_PULL_INTERVAL 10000
+/*
+ * Interrupt goes to whichever engine the window is for. TX_DONE is acked
+ * here, before the line is unmasked; DATA_READY stays until the RX
+ * engine took the frame, the line is disabled while it polls.
+ */
+static irqreturn_t plat_dummy_isr_thread(int irq, void *data)
+{
+	struct plat_dummy_device *my_device = data;
+	u32 status;
+
+	mutex_lock(&my_device->win_mutex);
+	status = plat_dummy_win_status(my_device);
+	mutex_unlock(&my_device->win_mutex);
+	if (plat_dummy_tx_ready(my_device, status))
+		plat_dummy_tx_kick(my_device);
+	if (plat_dummy_rx_pending(my_device, status))
+		plat_dummy_napi_schedule(my_device);
+	return IRQ_HANDLED;
+}
 
-int set_poll_interval(struct plat_dummy_device *my_device, u32 ms_interval)
+/*Writers use it to get TX going without waiting for the poller*/
+static void plat_dummy_kick(struct plat_dummy_device *my_device)
+{
+	bool backed_off;
+
+	plat_dummy_tx_kick(my_device);
+
+	/* window may be taken: polled devices come back to it soon */
+	if (plat_dummy_irq_mode(my_device) || READ_ONCE(my_device->hr_poll))
+		return;
+
+	spin_lock(&my_device->pool_lock);
+	backed_off = my_device->js_pool_cur > my_device->js_pool_time;
+	my_device->js_pool_cur = my_device->js_pool_time;
+	/* don't let the data wait for a long idle interval */
+	if (backed_off && !my_device->paused)
+		plat_dummy_mod_work(my_device, 0);
+	spin_unlock(&my_device->pool_lock);
+}
+
+static int plat_dummy_inject_irq(struct plat_dummy_device *my_device)
 {
-	pr_info("++%s(%p)\n", __func__, my_device);
 	if (!my_device)
 		return -EFAULT;
 
-	if ((ms_interval < MIN_PULL_INTERVAL) 
-	    || (ms_interval > MAX_PULL_INTERVAL)) {
+	if (!my_device->soft_irq)
+		return -EINVAL;
+
+	plat_dummy_napi_schedule(my_device);
+	return 0;
+}
+
+/*Registers are only read for the trace when someone is listening*/
+static void plat_dummy_trace_exit(struct plat_dummy_device *my_device,
+				  u64 rx_bytes, enum plat_poll_result res)
+{
+	if (trace_plat_dummy_work_exit_enabled())
+		trace_plat_dummy_work_exit(my_device->id,
+					   plat_dummy_reg_read32(my_device,
+								 PLAT_IO_FLAG_REG),
+					   my_device->rx_bytes - rx_bytes, res);
+}
+
+static void plat_dummy_poll_work(struct plat_dummy_device *my_device)
+{
+	enum plat_poll_result res = PLAT_POLL_IDLE;
+	u64 js_time, rx_bytes;
+	int done;
+
+	rx_bytes = my_device->rx_bytes;
+	if (trace_plat_dummy_work_enter_enabled())
+		trace_plat_dummy_work_enter(my_device->id,
+					    plat_dummy_reg_read32(my_device,
+								  PLAT_IO_FLAG_REG));
 
-		pr_err("%s: Value out of range %d\n", __func__, ms_interval);
-		return -EFAULT;
-	}
 	spin_lock(&my_device->pool_lock);
-	my_device->js_pool_time = msecs_to_jiffies(ms_interval);
+	js_time = my_device->js_pool_time;
 	spin_unlock(&my_device->pool_lock);
-	pr_info("%s: Setting Poliing Interval to %d ms\n", __func__, ms_interval);
-	return 0;
+
+	if (!plat_dummy_irq_mode(my_device)) {
+		res = plat_dummy_poll_once(my_device);
+		plat_dummy_trace_exit(my_device, rx_bytes, res);
+		/* hrtimer requeues us itself */
+		if (!READ_ONCE(my_device->hr_poll))
+			plat_dummy_queue_work(my_device,
+					      plat_dummy_next_interval(my_device,
+								       res));
+		return;
+	}
+
+	for (done = 0; done < PLAT_NAPI_BUDGET; done++) {
+		res = plat_dummy_poll_once(my_device);
+		if (res != PLAT_POLL_BUSY)
+			break;
+	}
+	plat_dummy_trace_exit(my_device, rx_bytes, res);
+
+	if (done == PLAT_NAPI_BUDGET) {
+		/* still under load: keep polling, let others run first */
+		plat_dummy_queue_work(my_device, 0);
+		return;
+	}
+
+	if (res == PLAT_POLL_STALLED) {
+		/* readers have to drain the ring, interrupts won't help */
+		plat_dummy_queue_work(my_device, js_time);
+		return;
+	}
+
+	if (!my_device->has_tx_done && READ_ONCE(my_device->tx_busy)) {
+		/* device won't interrupt when it takes our frame */
+		plat_dummy_queue_work(my_device, js_time);
+		return;
+	}
+
+	plat_dummy_napi_complete(my_device);
 }
 
 static void plat_dummy_work(struct work_struct *work)
 {
-	struct plat_dummy_device *my_device;
-	u32 i, size, status, count;
-	u64 js_time;
+	plat_dummy_poll_work(container_of(work, struct plat_dummy_device,
+					  dwork.work));
+}
 
-	my_device = container_of(work, struct plat_dummy_device, dwork.work);
+static void plat_dummy_kwork(struct kthread_work *work)
+{
+	plat_dummy_poll_work(container_of(work, struct plat_dummy_device,
+					  kdwork.work));
+}
 
+/*Stop everything which may run the poll work, e.g. to swap the ring*/
+static void plat_dummy_stop_polling(struct plat_dummy_device *my_device)
+{
 	spin_lock(&my_device->pool_lock);
-	js_time = my_device->js_pool_time;
+	my_device->paused = true;
 	spin_unlock(&my_device->pool_lock);
 
-	status = plat_dummy_reg_read32(my_device, PLAT_IO_FLAG_REG);
+	if (my_device->irq > 0)
+		disable_irq(my_device->irq);
+	hrtimer_cancel(&my_device->poll_timer);
+	plat_dummy_cancel_work(my_device);
+	cancel_work_sync(&my_device->tx_work);
+	/* engines step the emulator, which may queue its irq work */
+	plat_dummy_emu_stop(my_device);
+}
 
-	if (status & PLAT_IO_DATA_READY) {
-		if (mutex_lock_interruptible(&my_device->rd_mutex))
-			goto exit_wq;
-		size = plat_dummy_reg_read32(my_device, PLAT_IO_SIZE_REG);
+static void plat_dummy_start_polling(struct plat_dummy_device *my_device)
+{
+	spin_lock(&my_device->pool_lock);
+	my_device->paused = false;
+	spin_unlock(&my_device->pool_lock);
 
-		if (size > MEM_SIZE)
-			size = MEM_SIZE;
+	if (plat_dummy_irq_mode(my_device)) {
+		/* budgeted poll was cancelled, undo its disable_irq too */
+		if (test_and_clear_bit(PLAT_NAPI_SCHED, &my_device->napi_state) &&
+		    my_device->irq > 0)
+			enable_irq(my_device->irq);
+		if (my_device->irq > 0)
+			enable_irq(my_device->irq);
+		plat_dummy_napi_schedule(my_device);
+	} else if (my_device->hr_poll) {
+		hrtimer_start(&my_device->poll_timer, my_device->hr_interval,
+			      HRTIMER_MODE_REL);
+	} else {
+		plat_dummy_queue_work(my_device, 0);
+	}
+	plat_dummy_tx_kick(my_device);
+	plat_dummy_emu_start(my_device);
+}
 
-		count = min((size_t)size, (size_t)spacefree(my_device));
+/*Data area of the RX ring, size is a power of two*/
+static char *dummy_alloc_rx_ring(u32 *size)
+{
+	*size = roundup_pow_of_two(clamp_t(u32, *size, DUMMY_RX_RING_MIN,
+					   DUMMY_RX_RING_MAX));
+	return vmalloc_user(*size);
+}
 
-		if (count < size) {
-			mutex_unlock(&my_device->rd_mutex);
-			goto exit_wq;
-		}
+/*
+ * Data in the ring is dropped. Callers make sure nobody else has the
+ * device open; rd_mutex keeps readers and mmap() out, the poll work is
+ * stopped while the ring is swapped.
+ */
+static int plat_dummy_set_rx_ring_size(struct plat_dummy_device *my_device,
+				       u32 size)
+{
+	struct plat_dummy_reader *reader;
+	char *buffer, *old;
+	int ret = 0;
 
-		for(i = 0; i < count; i++) {
-			*my_device->wp++ = plat_dummy_mem_read8(my_device, i); /*my_device->residue + i*/
-			if (my_device->wp == my_device->end)
-			my_device->wp = my_device->buffer; /* wrapped */
-		}
+	if (!my_device)
+		return -EFAULT;
 
-		mutex_unlock (&my_device->rd_mutex);
-		wake_up_interruptible(&my_device->rwq);
-		rmb();
-		status &= ~PLAT_IO_DATA_READY;
-		status ^= PLAT_WRITE_READY;
-		plat_dummy_reg_write32(my_device, PLAT_IO_FLAG_REG, status);
+	if (size < DUMMY_RX_RING_MIN || size > DUMMY_RX_RING_MAX) {
+		pr_err("%s: Value out of range %u\n", __func__, size);
+		return -EINVAL;
+	}
+
+	buffer = dummy_alloc_rx_ring(&size);
+	if (!buffer)
+		return -ENOMEM;
+
+	mutex_lock(&my_device->cfg_mutex);
+	mutex_lock(&my_device->rd_mutex);
+	if (atomic_read(&my_device->rx_maps)) {
+		ret = -EBUSY;
+		old = buffer;
+		goto unlock;
+	}
+
+	plat_dummy_stop_polling(my_device);
+	old = my_device->buffer;
+	my_device->buffer = buffer;
+	my_device->buffersize = size;
+	my_device->ring_ctrl->size = size;
+	my_device->ring_ctrl->head = 0;
+	my_device->ring_ctrl->tail = 0;
+	my_device->frame_head = 0;
+	my_device->frame_tail = 0;
+	list_for_each_entry(reader, &my_device->readers, node)
+		reader->pos = 0;
+	memset(my_device->frames, 0,
+	       PLAT_RX_FRAMES * sizeof(*my_device->frames));
+	plat_dummy_start_polling(my_device);
+	pr_info("%s: RX ring is %u bytes\n", __func__, size);
+
+unlock:
+	mutex_unlock(&my_device->rd_mutex);
+	mutex_unlock(&my_device->cfg_mutex);
+	vfree(old);
+	return ret;
+}
+
+/*Move the poller between the device workqueue and a kthread of its own*/
+static int plat_dummy_set_poll_thread(struct plat_dummy_device *my_device,
+				      struct dummy_poll_thread *cfg)
+{
+	struct sched_param param = { .sched_priority = cfg->rt_prio };
+	struct kthread_worker *worker = NULL, *old;
+	int ret;
+
+	if (!my_device)
+		return -EFAULT;
+
+	if (cfg->mode > DUMMY_POLL_KTHREAD || cfg->rt_prio >= MAX_USER_RT_PRIO ||
+	    cfg->nice < MIN_NICE || cfg->nice > MAX_NICE ||
+	    (cfg->cpu >= 0 && (cfg->cpu >= nr_cpu_ids || !cpu_online(cfg->cpu)))) {
+		pr_err("%s: Value out of range\n", __func__);
+		return -EINVAL;
 	}
 
-	if (status & PLAT_WRITE_READY) {
-		if (my_device->bw_status) {
-			if(mutex_lock_interruptible(&my_device->rd_mutex))
-				goto exit_wq;
-			for(i = 0; i < MEM_SIZE; i++) {
-				plat_dummy_mem_write8(my_device, i,
-						      my_device->buffer_w[i]);
+	if (cfg->mode == DUMMY_POLL_KTHREAD) {
+		if ((cfg->rt_prio || cfg->nice < 0) && !capable(CAP_SYS_NICE))
+			return -EPERM;
+
+		if (cfg->cpu >= 0)
+			worker = kthread_create_worker_on_cpu(cfg->cpu, 0,
+							      "plat_dummy%d",
+							      my_device->id);
+		else
+			worker = kthread_create_worker(0, "plat_dummy%d",
+						       my_device->id);
+		if (IS_ERR(worker))
+			return PTR_ERR(worker);
+
+		if (cfg->rt_prio) {
+			ret = sched_setscheduler(worker->task, SCHED_FIFO,
+						 &param);
+			if (ret) {
+				kthread_destroy_worker(worker);
+				return ret;
 			}
-			plat_dummy_reg_write32(my_device, PLAT_IO_SIZE_REG,
-					       MEM_SIZE);
-			status ^= PLAT_IO_DATA_READY;
-			status &= ~PLAT_WRITE_READY;
-			plat_dummy_reg_write32(my_device, PLAT_IO_FLAG_REG,
-					       status);
-			my_device->bw_status = 0;
-			plat_dummy_reg_write32(my_device, PLAT_IO_SIZE_REG,
-					       my_device->bw_size_copied);
-			wake_up_interruptible(&my_device->wwq);
-			mutex_unlock(&my_device->rd_mutex);
+		} else {
+			set_user_nice(worker->task, cfg->nice);
 		}
 	}
 
-exit_wq:
-	queue_delayed_work(my_device->data_read_wq, &my_device->dwork, js_time);
+	mutex_lock(&my_device->cfg_mutex);
+	plat_dummy_stop_polling(my_device);
+	old = my_device->kworker;
+	my_device->kworker = worker;
+	plat_dummy_start_polling(my_device);
+	mutex_unlock(&my_device->cfg_mutex);
+
+	if (old)
+		kthread_destroy_worker(old);
+	pr_info("%s: Poller runs on %s\n", __func__,
+		worker ? "kthread" : "workqueue");
+	return 0;
+}
+
+static void dummy_free_data_buffer(struct plat_dummy_device *my_device)
+{
+	vfree(my_device->tx_buf);
+	vfree(my_device->tx_ctrl);
+	kfree(my_device->tx_len);
+	kfree(my_device->frames);
+	vfree(my_device->buffer);
+	vfree(my_device->ring_ctrl);
 }
 
-static void dummy_init_data_buffer(struct plat_dummy_device *my_device)
+/*Ring lives in its own page aligned areas, so it can be mapped to user.
+ * Power of two size lets the free running indices wrap with a mask.*/
+static int dummy_init_data_buffer(struct plat_dummy_device *my_device)
 {
-	my_device->buffersize = DUMMY_IO_BUFF_SIZE;
-	my_device->end = my_device->buffer + my_device->buffersize;
-	my_device->rp = my_device->wp = my_device->buffer;
+	my_device->buffersize = rx_ring_size;
+	my_device->buffer = dummy_alloc_rx_ring(&my_device->buffersize);
+	my_device->ring_ctrl = vmalloc_user(PAGE_SIZE);
+	if (!my_device->buffer || !my_device->ring_ctrl) {
+		dummy_free_data_buffer(my_device);
+		return -ENOMEM;
+	}
+	my_device->ring_ctrl->size = my_device->buffersize;
+
+	my_device->tx_slots = roundup_pow_of_two(clamp_t(u32, tx_slots, 1,
+							 MAX_TX_SLOTS));
+	my_device->tx_buf = vmalloc_user(my_device->tx_slots * MEM_SIZE);
+	my_device->tx_ctrl = vmalloc_user(PAGE_SIZE);
+	my_device->tx_len = kcalloc(my_device->tx_slots, sizeof(u32),
+				    GFP_KERNEL);
+	my_device->frames = kcalloc(PLAT_RX_FRAMES, sizeof(*my_device->frames),
+				    GFP_KERNEL);
+	if (!my_device->tx_buf || !my_device->tx_ctrl || !my_device->tx_len ||
+	    !my_device->frames) {
+		dummy_free_data_buffer(my_device);
+		return -ENOMEM;
+	}
+	BUILD_BUG_ON(sizeof(struct dummy_tx_ctrl) +
+		     MAX_TX_SLOTS * sizeof(u32) > PAGE_SIZE);
+	my_device->tx_ctrl->slots = my_device->tx_slots;
+	my_device->tx_ctrl->slot_size = MEM_SIZE;
+	return 0;
 }
 
-struct plat_dummy_device *get_dummy_platform_device(enum dummy_dev devnum)
+struct plat_dummy_device *get_dummy_platform_device(int devnum)
 {
-	if (mydevs[devnum])
-		return mydevs[devnum];
+	struct plat_dummy_device *my_device;
 
-	return NULL;
+	mutex_lock(&plat_dummy_idr_lock);
+	my_device = idr_find(&plat_dummy_idr, devnum);
+	mutex_unlock(&plat_dummy_idr_lock);
+
+	return my_device;
 }
 
 EXPORT_SYMBOL(get_dummy_platform_device);
 
+/*Device indexes are below this, there may be holes*/
+int get_dummy_platform_device_count(void)
+{
+	int count;
+
+	mutex_lock(&plat_dummy_idr_lock);
+	count = plat_dummy_nr_ids;
+	mutex_unlock(&plat_dummy_idr_lock);
+
+	return count;
+}
+
+EXPORT_SYMBOL(get_dummy_platform_device_count);
+
+/*DT alias "dummyN" first, then the id the module gave, then any free one*/
+static int plat_dummy_get_id(struct platform_device *pdev)
+{
+	int id = -1, ret;
+
+	if (pdev->dev.of_node)
+		id = of_alias_get_id(pdev->dev.of_node, "dummy");
+	else if (pdev->id >= 0)
+		id = pdev->id;
+
+	mutex_lock(&plat_dummy_idr_lock);
+	if (id >= 0)
+		ret = idr_alloc(&plat_dummy_idr, NULL, id, id + 1, GFP_KERNEL);
+	else
+		ret = idr_alloc(&plat_dummy_idr, NULL, 0, DUMMY_MAX_DEVICES,
+				GFP_KERNEL);
+	mutex_unlock(&plat_dummy_idr_lock);
+
+	return ret;
+}
+
+static void plat_dummy_put_id(void *data)
+{
+	struct plat_dummy_device *my_device = data;
+
+	mutex_lock(&plat_dummy_idr_lock);
+	idr_remove(&plat_dummy_idr, my_device->id);
+	mutex_unlock(&plat_dummy_idr_lock);
+}
+
+/*Probe is done, let the cdev side find the device*/
+static void plat_dummy_publish(struct plat_dummy_device *my_device)
+{
+	mutex_lock(&plat_dummy_idr_lock);
+	idr_replace(&plat_dummy_idr, my_device, my_device->id);
+	if (my_device->id >= plat_dummy_nr_ids)
+		plat_dummy_nr_ids = my_device->id + 1;
+	mutex_unlock(&plat_dummy_idr_lock);
+}
+
 static int plat_dummy_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
 	struct plat_dummy_device *my_device;
 	struct resource *res;
-	static int id = 0;
+	int id, irq, ret;
 	rmb();
 
 	my_device = devm_kzalloc(dev, sizeof(struct plat_dummy_device), GFP_KERNEL);
 	if (!my_device)
 		return -ENOMEM;
 
-	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
-	my_device->mem = devm_ioremap_resource(&pdev->dev, res);
-	if (IS_ERR(my_device->mem))
-		return PTR_ERR(my_device->mem);
-	res = platform_get_resource(pdev, IORESOURCE_MEM, 1);
-	my_device->regs = devm_ioremap_resource(&pdev->dev, res);
-	if (IS_ERR(my_device->regs))
-		return PTR_ERR(my_device->regs);
+	id = plat_dummy_get_id(pdev);
+	if (id < 0) {
+		dev_err(dev, "no free device index (%d)\n", id);
+		return id;
+	}
+	my_device->id = id;
+	ret = devm_add_action_or_reset(dev, plat_dummy_put_id, my_device);
+	if (ret)
+		return ret;
+
+	my_device->pdev = pdev;
+	if (emulate && !dev->of_node) {
+		ret = plat_dummy_emu_init(my_device);
+		if (ret)
+			return ret;
+		my_device->has_tx_done = true;
+	} else {
+		my_device->has_tx_done = of_property_read_bool(dev->of_node,
+							       "ti,tx-done");
+		res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+		my_device->mem = devm_ioremap_resource(&pdev->dev, res);
+		if (IS_ERR(my_device->mem))
+			return PTR_ERR(my_device->mem);
+		res = platform_get_resource(pdev, IORESOURCE_MEM, 1);
+		my_device->regs = devm_ioremap_resource(&pdev->dev, res);
+		if (IS_ERR(my_device->regs))
+			return PTR_ERR(my_device->regs);
+	}
 	platform_set_drvdata(pdev, my_device);
 	pr_info("Memory mapped to %p\n", my_device->mem);
 	pr_info("Registers mapped to %p\n", my_device->regs);
+	if (dummy_init_data_buffer(my_device))
+		return -ENOMEM;
 	/*Init data read WQ*/
-	my_device->data_read_wq = alloc_workqueue(res->name,
-	WQ_UNBOUND, MAX_DUMMY_PLAT_THREADS);
-	if (!my_device->data_read_wq)
+	/* cpumask, nice and numa are in /sys/devices/virtual/workqueue/ */
+	my_device->data_read_wq = alloc_workqueue("plat_dummy%d",
+	WQ_UNBOUND | WQ_SYSFS | (poll_highpri ? WQ_HIGHPRI : 0),
+	MAX_DUMMY_PLAT_THREADS, id);
+	if (!my_device->data_read_wq) {
+		dummy_free_data_buffer(my_device);
 		return -ENOMEM;
+	}
 	mutex_init(&my_device->rd_mutex);
+	mutex_init(&my_device->wr_mutex);
 	init_waitqueue_head(&my_device->rwq);
 	init_waitqueue_head(&my_device->wwq);
-	dummy_init_data_buffer(my_device);
 	my_device->dummy_read = plat_dummy_read;
 	my_device->dummy_write = plat_dummy_write;
+	my_device->dummy_poll = plat_dummy_poll;
 	my_device->set_poll_interval = set_poll_interval;
+	my_device->set_poll_interval_us = set_poll_interval_us;
+	my_device->get_poll_overruns = get_poll_overruns;
+	my_device->set_poll_backoff = set_poll_backoff;
+	my_device->get_poll_interval_us = get_poll_interval_us;
+	my_device->dummy_mmap = plat_dummy_mmap;
+	my_device->rx_advance = plat_dummy_rx_advance;
+	my_device->get_tx_stats = plat_dummy_get_tx_stats;
+	my_device->dummy_read_frame = plat_dummy_read_frame;
+	my_device->recv_frames = plat_dummy_recv_frames;
+	my_device->set_rx_ring_size = plat_dummy_set_rx_ring_size;
+	my_device->set_rx_policy = set_rx_policy;
+	my_device->get_rx_drops = get_rx_drops;
+	my_device->get_stats = get_stats;
+	my_device->set_poll_thread = plat_dummy_set_poll_thread;
+	my_device->rx_subscribe = plat_dummy_rx_subscribe;
+	my_device->rx_unsubscribe = plat_dummy_rx_unsubscribe;
+	my_device->read_reader = plat_dummy_read_reader;
+	my_device->poll_reader = plat_dummy_poll_reader;
+	my_device->get_reader_lag = plat_dummy_get_reader_lag;
+	my_device->set_rx_evict = set_rx_evict;
+	my_device->set_ts_clock = set_ts_clock;
+	my_device->set_tx_coalesce = set_tx_coalesce;
+	my_device->tx_flush = plat_dummy_tx_flush;
+	my_device->tx_doorbell = plat_dummy_tx_doorbell;
+	hrtimer_init(&my_device->tx_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	my_device->tx_timer.function = plat_dummy_tx_timer;
+	INIT_WORK(&my_device->tx_flush_work, plat_dummy_tx_flush_work);
+	INIT_LIST_HEAD(&my_device->readers);
 	spin_lock_init(&my_device->pool_lock);
-	my_device->bw_status = 0;
-	my_device->bw_size_copied = 0;
+	mutex_init(&my_device->cfg_mutex);
+	hrtimer_init(&my_device->poll_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	my_device->poll_timer.function = plat_dummy_hr_poll;
 	INIT_DELAYED_WORK(&my_device->dwork, plat_dummy_work);
+	INIT_WORK(&my_device->tx_work, plat_dummy_tx_work);
+	mutex_init(&my_device->win_mutex);
+	kthread_init_delayed_work(&my_device->kdwork, plat_dummy_kwork);
 	my_device->js_pool_time = msecs_to_jiffies(DEVICE_POOLING_TIME_MS);
-	queue_delayed_work(my_device->data_read_wq, &my_device->dwork, 0);
-	my_device->pdev = pdev;
-	mydevs[id] = my_device;
-	id++;
+	my_device->js_pool_cur = my_device->js_pool_time;
+	my_device->js_pool_max = my_device->js_pool_time;
+	my_device->pool_backoff = 1;
+	my_device->inject_irq = plat_dummy_inject_irq;
+	my_device->soft_irq = id < 32 && (soft_irq_mask & BIT(id));
 	plat_dummy_reg_write32(my_device, PLAT_IO_FLAG_REG, PLAT_WRITE_READY);
 
+	/*IRQ line is optional, the device is polled without it*/
+	irq = platform_get_irq(pdev, 0);
+	if (irq > 0) {
+		ret = devm_request_threaded_irq(dev, irq, plat_dummy_isr,
+						plat_dummy_isr_thread,
+						IRQF_ONESHOT, dev_name(dev),
+						my_device);
+		if (ret) {
+			destroy_workqueue(my_device->data_read_wq);
+			dummy_free_data_buffer(my_device);
+			return ret;
+		}
+		my_device->irq = irq;
+	}
+
+	plat_dummy_publish(my_device);
+	if (plat_dummy_irq_mode(my_device))
+		plat_dummy_napi_schedule(my_device);
+	else
+		plat_dummy_queue_work(my_device, 0);
+	plat_dummy_emu_start(my_device);
+
 	return PTR_ERR_OR_ZERO(my_device->mem);
 }
 
@@ -361,37 +2290,71 @@ static int plat_dummy_remove(struct platform_device *pdev)
 {
 	struct plat_dummy_device *my_device = platform_get_drvdata(pdev);
 
+	/* an empty open slot keeps the flush work from re-arming the timer */
+	mutex_lock(&my_device->wr_mutex);
+	my_device->tx_fill = 0;
+	mutex_unlock(&my_device->wr_mutex);
+	hrtimer_cancel(&my_device->tx_timer);
+	cancel_work_sync(&my_device->tx_flush_work);
+	plat_dummy_stop_polling(my_device);
+	if (my_device->irq > 0)
+		devm_free_irq(&pdev->dev, my_device->irq, my_device);
+	if (my_device->kworker)
+		kthread_destroy_worker(my_device->kworker);
 	if (my_device->data_read_wq) {
 		/* Destroy work Queue */
-		cancel_delayed_work_sync(&my_device->dwork);
 		destroy_workqueue(my_device->data_read_wq);
 	}
+	dummy_free_data_buffer(my_device);
 	pr_info("Platform device has been removed.\n");
 	return 0;
 }
 
+static const struct of_device_id plat_dummy_of_match[] = {
+	{ .compatible = "ti,plat_dummy" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, plat_dummy_of_match);
+
 static struct platform_driver plat_dummy_driver = {
 	.driver = {
 			.name =	DRV_NAME,
+			.of_match_table = plat_dummy_of_match,
 		  },
 
 	.probe =	plat_dummy_probe,
 	.remove =	plat_dummy_remove,
 };
 
-static int __init plat_dummy_device_add(struct resource *res)
+static int __init plat_dummy_device_add(int id)
 {
 	int err;
 	struct platform_device *pdev = NULL;
+	struct resource res[2] = {
+		{
+		.start	= MEM_BASE_1 + id * DEV_STRIDE,
+		.end	= MEM_BASE_1 + id * DEV_STRIDE + MEM_SIZE - 1,
+		.name	= "dummy_mem",
+		.flags	= IORESOURCE_MEM,
+		},
+
+		{
+		.start	= REG_BASE_1 + id * DEV_STRIDE,
+		.end	= REG_BASE_1 + id * DEV_STRIDE + REG_SIZE - 1,
+		.name	= "dummy_regs",
+		.flags	= IORESOURCE_MEM,
+		}
+	};
 
-	pdev = platform_device_alloc(DRV_NAME, res[0].start);
+	pdev = platform_device_alloc(DRV_NAME, id);
 	if (!pdev) {
 		err = -ENOMEM;
 		pr_err("Device allocation failed\n");
 		goto exit;
 	}
 
-	err = platform_device_add_resources(pdev, res, 2);
+	/* emulated devices have no resources, the driver makes them up */
+	err = emulate ? 0 : platform_device_add_resources(pdev, res, 2);
 	if (err) {
 		pr_err("Device resource addition failed (%d)\n", err);
 		goto exit_device_put;
@@ -401,6 +2364,7 @@ static int __init plat_dummy_device_add(struct resource *res)
 		pr_err("Device addition failed (%d)\n", err);
 		goto exit_device_put;
 	}
+	dummy_pdevs[id] = pdev;
 	pr_info("Platform device has been added.\n");
 	return 0;
 
@@ -411,34 +2375,54 @@ exit:
 	return err;
 }
 
+static void plat_dummy_devices_del(void)
+{
+	int i;
+
+	for (i = 0; i < num_devices; i++)
+		if (dummy_pdevs[i])
+			platform_device_unregister(dummy_pdevs[i]);
+	kfree(dummy_pdevs);
+}
+
 static int plat_dummy_driver_register(void)
 {
-	int res;
+	int res, i;
+
+	if (num_devices > DUMMY_MAX_DEVICES) {
+		pr_err("num_devices %u is above %d\n", num_devices,
+		       DUMMY_MAX_DEVICES);
+		return -EINVAL;
+	}
+
+	dummy_pdevs = kcalloc(num_devices, sizeof(*dummy_pdevs), GFP_KERNEL);
+	if (!dummy_pdevs)
+		return -ENOMEM;
 
 	res = platform_driver_register(&plat_dummy_driver);
 	if (res)
 		goto exit;
 
-	res = plat_dummy_device_add(res_1);
-	if (res)
-		goto exit_unreg_driver;
-
-	res = plat_dummy_device_add(res_2);
-	if (res)
-		goto exit_unreg_driver;
+	for (i = 0; i < num_devices; i++) {
+		res = plat_dummy_device_add(i);
+		if (res)
+			goto exit_unreg_driver;
+	}
 
 	return 0;
 
 exit_unreg_driver:
+	plat_dummy_devices_del();
 	platform_driver_unregister(&plat_dummy_driver);
+	return res;
 exit:
+	kfree(dummy_pdevs);
 	return res;
 }
 
 static void plat_dummy_unregister(void)
 {
-	platform_device_unregister(mydevs[0]->pdev);
-	platform_device_unregister(mydevs[1]->pdev);
+	plat_dummy_devices_del();
 	platform_driver_unregister(&plat_dummy_driver);
 }
 
@@ -2,38 +2,166 @@
 #define _PLATFORM_TEST_H_
 
 #define DUMMY_IO_BUFF_SIZE (5*1024)
+
+struct dummy_ring_ctrl;
+struct dummy_tx_ctrl;
+struct dummy_backoff;
+struct dummy_tx_stats;
+struct dummy_tx_coalesce;
+struct vm_area_struct;
+struct poll_table_struct;
+struct iov_iter;
+struct file;
+struct plat_dummy_frame;
+
+/*Broadcast reader: a cursor of its own into the shared RX ring. It is
+ * owned by the open file, node is empty while it isn't subscribed.*/
+struct plat_dummy_reader {
+	struct list_head node;	   /* on readers, rd_mutex */
+	u32 pos;		   /* ring counter of the next byte to read */
+	u32 lag_max;		   /* most bytes it was ever behind */
+	u64 dropped;		   /* bytes it lost to DUMMY_RX_DROP_OLDEST */
+	bool evicted;		   /* fell behind rx_evict_lag */
+};
+
+struct dummy_recv_frames;
+struct dummy_reader_lag;
+struct dummy_rx_drops;
+struct dummy_stats;
+struct dummy_poll_thread;
+struct plat_dummy_emu;
+
 struct plat_dummy_device {
 	struct platform_device *pdev;
+	int id;			   /* device index, as in /dev/dummy/dummyN */
+	struct plat_dummy_emu *emu;	   /* NULL: real hardware */
 	void __iomem *mem;
 	void __iomem *regs;
-	struct delayed_work     dwork;
+	struct delayed_work     dwork;	   /* RX engine, also polls for TX */
+	struct kthread_worker *kworker;	   /* NULL: poll on data_read_wq */
+	struct kthread_delayed_work kdwork;
+	struct work_struct tx_work;	   /* TX engine, always on data_read_wq */
 	struct workqueue_struct *data_read_wq;
-	u64 js_pool_time;
+	struct mutex win_mutex;	   /* window and flag register */
+	bool tx_busy;		   /* DATA_READY is our TX frame, win_mutex */
+	bool has_tx_done;	   /* device acks TX with PLAT_TX_DONE */
+	u64 js_pool_time;	   /* minimal interval */
+	u64 js_pool_max;	   /* idle backoff limit */
+	u64 js_pool_cur;	   /* interval in use */
+	u32 pool_backoff;	   /* idle backoff factor, 1 - off */
+	struct mutex cfg_mutex;	   /* polling engine switch */
+	struct hrtimer poll_timer; /* sub-jiffy polling */
+	ktime_t hr_interval;
+	bool hr_poll;		   /* poller driven by poll_timer */
+	u64 hr_overruns;	   /* timer periods the poller missed */
+	int irq;		   /* 0 - no interrupt line, polled */
+	bool soft_irq;		   /* interrupts come from inject_irq() */
+	unsigned long napi_state;
+	bool paused;		   /* nothing may queue the poll work */
 	spinlock_t pool_lock;
 	wait_queue_head_t rwq;	   /* read queues */
 	wait_queue_head_t wwq;
-	struct mutex rd_mutex;
-	char buffer[DUMMY_IO_BUFF_SIZE];
-	char *end;		   /* begin of buf, end of buf */
-	char buffer_w[DUMMY_IO_BUFF_SIZE];
-	char *end_w;
-	char bw_status;
-	int  bw_size_copied;
-	u32 buffersize;				    /* used in pointer arithmetic */
-	char *rp, *wp, *rp_w, *wp_w;			    /* where to read, where to write */
+	struct mutex rd_mutex;	   /* readers of the RX ring */
+	struct mutex wr_mutex;	   /* writers of the TX queue */
+	struct dummy_ring_ctrl *ring_ctrl; /* shared with mmap() readers */
+	char *buffer;		   /* RX data, indexed by ring_ctrl head/tail */
+	atomic_t rx_maps;	   /* user mappings of the ring */
+	char *tx_buf;		   /* tx_slots frames of MEM_SIZE */
+	struct dummy_tx_ctrl *tx_ctrl; /* shared with mmap() writers */
+	atomic_t tx_maps;	   /* user mappings of the TX queue */
+	u32 *tx_len;
+	u32 tx_slots;		   /* power of two */
+	u32 tx_head;		   /* frames queued by writers */
+	u32 tx_tail;		   /* frames flushed to device */
+	u32 tx_depth_max;
+	u32 tx_fill;		   /* bytes in the open slot at tx_head */
+	u32 tx_coalesce;	   /* publish at this fill, 0: every write */
+	u64 tx_coalesce_ns;	   /* publish this long after the first byte */
+	u64 tx_open_ns;
+	struct hrtimer tx_timer;
+	struct work_struct tx_flush_work;
+	u64 tx_stalls, tx_stall_ns; /* writers blocked on a full queue */
+	u64 rx_xfers, rx_xfer_cycles;	    /* bulk MMIO transfer cost */
+	u64 tx_xfers, tx_xfer_cycles;
+	u64 rx_bytes, tx_bytes;
+	u64 poll_cycles, empty_polls;
+	u64 ring_hwm;		   /* most bytes ever waiting in the ring */
+	u64 rd_sleeps;		   /* readers which found the ring empty */
+	u64 rd_contended, wr_contended; /* rd_mutex/wr_mutex found taken */
+	u32 buffersize;				    /* power of two */
+	struct plat_dummy_frame *frames;
+	u32 frame_head;		   /* frames received, producer only */
+	u32 frame_tail;		   /* next frame for readers, rd_mutex */
+	u32 rx_policy;		   /* DUMMY_RX_*: what to do on a full ring */
+	struct list_head readers;  /* broadcast readers, rd_mutex */
+	u32 nr_readers;
+	u32 rx_evict_lag;	   /* 0: slow readers are never evicted */
+	u32 ts_clock;		   /* DUMMY_TS_*: clock of frame timestamps */
+	u64 rx_seen_ns;		   /* pending frame was seen, 0: none */
+	bool rx_stalled;	   /* device frame waits for room */
+	u64 rx_overruns;	   /* frames which found the ring full */
+	u64 rx_dropped;		   /* bytes lost to rx_policy */
 	ssize_t (*dummy_read) (struct plat_dummy_device *my_device,
-			       char __user *buf, size_t count);
+			       struct iov_iter *to, bool nonblock);
 	ssize_t (*dummy_write) (struct plat_dummy_device *my_device,
-				const char __user *bug, size_t count);
+				struct iov_iter *from, bool nonblock);
+	unsigned int (*dummy_poll) (struct plat_dummy_device *my_device,
+				    struct file *filp,
+				    struct poll_table_struct *wait);
 	int (*set_poll_interval) (struct plat_dummy_device *my_device,
 				  u32 ms_interval);
+	int (*dummy_mmap) (struct plat_dummy_device *my_device,
+			   struct vm_area_struct *vma);
+	int (*rx_advance) (struct plat_dummy_device *my_device, u32 count);
+	int (*inject_irq) (struct plat_dummy_device *my_device);
+	int (*set_poll_interval_us) (struct plat_dummy_device *my_device,
+				     u32 us_interval);
+	int (*get_poll_overruns) (struct plat_dummy_device *my_device,
+				  u64 *overruns);
+	int (*set_poll_backoff) (struct plat_dummy_device *my_device,
+				 const struct dummy_backoff *cfg);
+	int (*get_poll_interval_us) (struct plat_dummy_device *my_device,
+				     u32 *us_interval);
+	int (*get_tx_stats) (struct plat_dummy_device *my_device,
+			     struct dummy_tx_stats *stats);
+	ssize_t (*dummy_read_frame) (struct plat_dummy_device *my_device,
+				     struct iov_iter *to, bool nonblock);
+	int (*recv_frames) (struct plat_dummy_device *my_device,
+			    struct dummy_recv_frames *req, u64 ts,
+			    bool nonblock);
+	int (*set_rx_ring_size) (struct plat_dummy_device *my_device,
+				 u32 size);
+	int (*set_rx_policy) (struct plat_dummy_device *my_device, u32 policy);
+	int (*get_rx_drops) (struct plat_dummy_device *my_device,
+			     struct dummy_rx_drops *drops);
+	int (*get_stats) (struct plat_dummy_device *my_device,
+			  struct dummy_stats *stats);
+	int (*set_poll_thread) (struct plat_dummy_device *my_device,
+				struct dummy_poll_thread *cfg);
+	int (*rx_subscribe) (struct plat_dummy_device *my_device,
+			     struct plat_dummy_reader *reader);
+	void (*rx_unsubscribe) (struct plat_dummy_device *my_device,
+				struct plat_dummy_reader *reader);
+	ssize_t (*read_reader) (struct plat_dummy_device *my_device,
+				struct plat_dummy_reader *reader,
+				struct iov_iter *to, bool nonblock);
+	unsigned int (*poll_reader) (struct plat_dummy_device *my_device,
+				     struct plat_dummy_reader *reader,
+				     struct file *filp,
+				     struct poll_table_struct *wait);
+	int (*get_reader_lag) (struct plat_dummy_device *my_device,
+			       struct plat_dummy_reader *reader,
+			       struct dummy_reader_lag *lag);
+	int (*set_rx_evict) (struct plat_dummy_device *my_device, u32 lag);
+	int (*set_ts_clock) (struct plat_dummy_device *my_device, u32 clock);
+	int (*set_tx_coalesce) (struct plat_dummy_device *my_device,
+				struct dummy_tx_coalesce *coalesce);
+	int (*tx_flush) (struct plat_dummy_device *my_device, bool wait);
+	int (*tx_doorbell) (struct plat_dummy_device *my_device);
 };
 
-enum dummy_dev {
-	DUMMY_DEV_1,
-	DUMMY_DEV_2,
-	DUMMY_DEVICES
-};
+#define DUMMY_MAX_DEVICES 64
 
-struct plat_dummy_device *get_dummy_platform_device(enum dummy_dev devnum);
+struct plat_dummy_device *get_dummy_platform_device(int devnum);
+int get_dummy_platform_device_count(void);
 #endif
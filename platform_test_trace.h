@@ -0,0 +1,146 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM plat_dummy
+
+#if !defined(_PLATFORM_TEST_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _PLATFORM_TEST_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+/*
+ * Hot path events, all of them carry the device index:
+ * echo 1 > /sys/kernel/debug/tracing/events/plat_dummy/enable
+ */
+
+TRACE_EVENT(plat_dummy_work_enter,
+	TP_PROTO(int id, u32 status),
+	TP_ARGS(id, status),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(u32, status)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->status = status;
+	),
+	TP_printk("dev=%d status=0x%x", __entry->id, __entry->status)
+);
+
+TRACE_EVENT(plat_dummy_work_exit,
+	TP_PROTO(int id, u32 status, u64 rx_bytes, int res),
+	TP_ARGS(id, status, rx_bytes, res),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(u32, status)
+		__field(u64, rx_bytes)
+		__field(int, res)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->status = status;
+		__entry->rx_bytes = rx_bytes;
+		__entry->res = res;
+	),
+	TP_printk("dev=%d status=0x%x rx=%llu res=%d",
+		  __entry->id, __entry->status, __entry->rx_bytes,
+		  __entry->res)
+);
+
+/*TX engine pass: frames and bytes it pushed to the device*/
+TRACE_EVENT(plat_dummy_tx_work,
+	TP_PROTO(int id, u32 frames, u64 tx_bytes),
+	TP_ARGS(id, frames, tx_bytes),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(u32, frames)
+		__field(u64, tx_bytes)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->frames = frames;
+		__entry->tx_bytes = tx_bytes;
+	),
+	TP_printk("dev=%d frames=%u tx=%llu", __entry->id, __entry->frames,
+		  __entry->tx_bytes)
+);
+
+/*RX ring: pos is the ring counter before the operation*/
+DECLARE_EVENT_CLASS(plat_dummy_ring,
+	TP_PROTO(int id, u32 pos, u32 len),
+	TP_ARGS(id, pos, len),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(u32, pos)
+		__field(u32, len)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->pos = pos;
+		__entry->len = len;
+	),
+	TP_printk("dev=%d pos=%u len=%u", __entry->id, __entry->pos,
+		  __entry->len)
+);
+
+DEFINE_EVENT(plat_dummy_ring, plat_dummy_rx_push,
+	TP_PROTO(int id, u32 pos, u32 len),
+	TP_ARGS(id, pos, len)
+);
+
+DEFINE_EVENT(plat_dummy_ring, plat_dummy_rx_pop,
+	TP_PROTO(int id, u32 pos, u32 len),
+	TP_ARGS(id, pos, len)
+);
+
+/*TX queue: pos is the slot counter*/
+DEFINE_EVENT(plat_dummy_ring, plat_dummy_tx_fill,
+	TP_PROTO(int id, u32 pos, u32 len),
+	TP_ARGS(id, pos, len)
+);
+
+DEFINE_EVENT(plat_dummy_ring, plat_dummy_tx_flush,
+	TP_PROTO(int id, u32 pos, u32 len),
+	TP_ARGS(id, pos, len)
+);
+
+/*Blocking readers and writers: avail is what they found on the way*/
+DECLARE_EVENT_CLASS(plat_dummy_sleep,
+	TP_PROTO(int id, u32 avail),
+	TP_ARGS(id, avail),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(u32, avail)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->avail = avail;
+	),
+	TP_printk("dev=%d avail=%u", __entry->id, __entry->avail)
+);
+
+DEFINE_EVENT(plat_dummy_sleep, plat_dummy_reader_wait,
+	TP_PROTO(int id, u32 avail),
+	TP_ARGS(id, avail)
+);
+
+DEFINE_EVENT(plat_dummy_sleep, plat_dummy_reader_wake,
+	TP_PROTO(int id, u32 avail),
+	TP_ARGS(id, avail)
+);
+
+DEFINE_EVENT(plat_dummy_sleep, plat_dummy_writer_wait,
+	TP_PROTO(int id, u32 avail),
+	TP_ARGS(id, avail)
+);
+
+DEFINE_EVENT(plat_dummy_sleep, plat_dummy_writer_wake,
+	TP_PROTO(int id, u32 avail),
+	TP_ARGS(id, avail)
+);
+
+#endif /* _PLATFORM_TEST_TRACE_H_ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE platform_test_trace
+#include <trace/define_trace.h>
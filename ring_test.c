@@ -0,0 +1,606 @@
+/*
+ * Userspace test of platform_ring.h: RX ring wrap-around, full/empty
+ * edges, frame table reuse, the TX queue indexes, coalescing and mmap()
+ * merge, the window protocol for devices with and without TX_DONE, and
+ * a threaded RX producer/consumer with push/pop cost in ns per byte.
+ * Builds the driver's header against a mock device:
+ *	make test
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "platform_cdev.h"
+
+typedef uint32_t u32;
+typedef int32_t s32;
+typedef uint64_t u64;
+
+#define READ_ONCE(x)		__atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define WRITE_ONCE(x, v)	__atomic_store_n(&(x), v, __ATOMIC_RELAXED)
+#define smp_load_acquire(p)	__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define smp_store_release(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define smp_wmb()		__atomic_thread_fence(__ATOMIC_RELEASE)
+#define smp_rmb()		__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define min(a, b)		((a) < (b) ? (a) : (b))
+#define min_t(t, a, b)		min((t)(a), (t)(b))
+
+/*The fields platform_ring.h works on, named as in platform_test.h*/
+struct plat_dummy_device {
+	struct dummy_ring_ctrl *ring_ctrl;
+	char *buffer;
+	u32 buffersize;
+	struct plat_dummy_frame *frames;
+	u32 frame_head;
+	u32 frame_tail;
+	char *tx_buf;
+	struct dummy_tx_ctrl *tx_ctrl;
+	u32 *tx_len;
+	u32 tx_slots;
+	u32 tx_head;
+	u32 tx_tail;
+	u32 tx_depth_max;
+	u32 tx_fill;
+	bool tx_busy;
+	bool has_tx_done;
+};
+
+#include "platform_ring.h"
+
+#define RING_SIZE	(16 * 1024)
+#define STRESS_FRAMES	(500 * 1000)
+#define BENCH_BYTES	(256ull << 20)
+
+static int failed;
+
+#define CHECK(cond) do {						\
+	if (!(cond)) {							\
+		fprintf(stderr, "%s:%d: %s\n", __func__, __LINE__, #cond); \
+		failed++;						\
+	}								\
+} while (0)
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/*Ring of size bytes with both counters at pos*/
+static void dev_init(struct plat_dummy_device *dev, u32 size, u32 pos)
+{
+	static struct dummy_ring_ctrl ctrl;
+
+	memset(dev, 0, sizeof(*dev));
+	dev->ring_ctrl = &ctrl;
+	dev->buffersize = size;
+	dev->buffer = calloc(1, size);
+	dev->frames = calloc(PLAT_RX_FRAMES, sizeof(*dev->frames));
+	if (!dev->buffer || !dev->frames) {
+		perror("calloc");
+		exit(1);
+	}
+	ctrl.head = ctrl.tail = pos;
+	ctrl.size = size;
+}
+
+static void dev_free(struct plat_dummy_device *dev)
+{
+	free(dev->buffer);
+	free(dev->frames);
+}
+
+/*plat_dummy_rx_store(), with src in place of the window*/
+static bool push(struct plat_dummy_device *dev, const char *src, u32 size)
+{
+	u32 head, off, first;
+
+	if (plat_dummy_rx_free(dev) < size)
+		return false;
+
+	head = dev->ring_ctrl->head;
+	first = plat_dummy_ring_split(dev, head, size, &off);
+	memcpy(dev->buffer + off, src, first);
+	memcpy(dev->buffer, src + first, size - first);
+	plat_dummy_ring_commit(dev, head, size, 0, 0);
+	return true;
+}
+
+/*plat_dummy_read_frame(), dst in place of the user buffer*/
+static bool pop(struct plat_dummy_device *dev, char *dst,
+		struct plat_dummy_frame *frame)
+{
+	u32 off, first;
+
+	if (!plat_dummy_next_frame(dev, frame))
+		return false;
+
+	first = plat_dummy_ring_split(dev, frame->start, frame->len, &off);
+	memcpy(dst, dev->buffer + off, first);
+	memcpy(dst + first, dev->buffer, frame->len - first);
+	plat_dummy_frame_consume(dev, frame);
+	return true;
+}
+
+static void test_split(void)
+{
+	struct plat_dummy_device dev;
+	u32 off;
+
+	dev_init(&dev, 4096, 0);
+	CHECK(plat_dummy_ring_split(&dev, 0, 100, &off) == 100 && off == 0);
+	CHECK(plat_dummy_ring_split(&dev, 4000, 96, &off) == 96 && off == 4000);
+	CHECK(plat_dummy_ring_split(&dev, 4000, 97, &off) == 96 && off == 4000);
+	CHECK(plat_dummy_ring_split(&dev, 4096, 10, &off) == 10 && off == 0);
+	CHECK(plat_dummy_ring_split(&dev, 3 * 4096 + 1, 4096, &off) == 4095 &&
+	      off == 1);
+	/* free running counter past 2^32 */
+	CHECK(plat_dummy_ring_split(&dev, UINT32_MAX, 2, &off) == 1 &&
+	      off == 4095);
+	CHECK(plat_dummy_ring_split(&dev, 0, 0, &off) == 0 && off == 0);
+	dev_free(&dev);
+}
+
+/*Fill to the last byte and drain it again, counters start at start*/
+static void test_full_empty(u32 start)
+{
+	struct plat_dummy_device dev;
+	struct plat_dummy_frame frame;
+	char src[1000], dst[1000];
+	u32 i, n = 0, bytes = 0;
+
+	dev_init(&dev, 4096, start);
+	CHECK(plat_dummy_rx_used(&dev) == 0);
+	CHECK(plat_dummy_rx_free(&dev) == 4096);
+	CHECK(!plat_dummy_next_frame(&dev, &frame));
+
+	for (i = 0; i < sizeof(src); i++)
+		src[i] = i;
+	/* 4 x 1000 and the last 96 bytes */
+	while (push(&dev, src, 1000))
+		n++, bytes += 1000;
+	CHECK(n == 4);
+	CHECK(push(&dev, src, 96));
+	n++, bytes += 96;
+	CHECK(plat_dummy_rx_free(&dev) == 0);
+	CHECK(plat_dummy_rx_used(&dev) == 4096);
+	CHECK(!push(&dev, src, 1));
+
+	for (i = 0; i < n; i++) {
+		CHECK(pop(&dev, dst, &frame));
+		CHECK(frame.seq == i);
+		CHECK(frame.start == start + i * 1000);
+		CHECK(frame.len == (i < 4 ? 1000 : 96));
+		CHECK(!memcmp(dst, src, frame.len));
+		bytes -= frame.len;
+		CHECK(plat_dummy_rx_used(&dev) == bytes);
+	}
+	CHECK(!pop(&dev, dst, &frame));
+	CHECK(plat_dummy_rx_free(&dev) == 4096);
+	CHECK(dev.ring_ctrl->head == start + 4096);
+	dev_free(&dev);
+}
+
+/*More frames than table entries: the oldest are dropped with their data*/
+static void test_frame_reuse(void)
+{
+	struct plat_dummy_device dev;
+	struct plat_dummy_frame frame;
+	char src[16] = { 0 }, dst[16];
+	u32 i, n = PLAT_RX_FRAMES + 10;
+
+	dev_init(&dev, 64 * 1024, 0);
+	for (i = 0; i < n; i++) {
+		src[0] = i;
+		CHECK(push(&dev, src, 16));
+	}
+
+	/* the first entry still valid is head - PLAT_RX_FRAMES + 1 */
+	CHECK(pop(&dev, dst, &frame));
+	CHECK(frame.seq == n - PLAT_RX_FRAMES + 1);
+	CHECK(dst[0] == (char)frame.seq);
+	CHECK(dev.ring_ctrl->tail == frame.start + 16);
+	for (i = frame.seq + 1; pop(&dev, dst, &frame); i++)
+		CHECK(frame.seq == i && dst[0] == (char)i);
+	CHECK(i == n);
+	CHECK(plat_dummy_rx_used(&dev) == 0);
+	dev_free(&dev);
+}
+
+/*Byte stream reader took part of the ring under the framed one*/
+static void test_byte_reader(void)
+{
+	struct plat_dummy_device dev;
+	struct plat_dummy_frame frame;
+	char src[100] = { 0 }, dst[100];
+
+	dev_init(&dev, 4096, 0);
+	CHECK(push(&dev, src, 100));
+	CHECK(push(&dev, src, 100));
+	src[0] = 3;
+	CHECK(push(&dev, src, 100));
+
+	/* first frame and half of the second one read as bytes */
+	dev.ring_ctrl->tail = 150;
+	CHECK(pop(&dev, dst, &frame));
+	CHECK(frame.seq == 2 && frame.start == 200 && dst[0] == 3);
+	CHECK(!pop(&dev, dst, &frame));
+
+	/* all of it read as bytes: nothing left for frames */
+	CHECK(push(&dev, src, 100));
+	dev.ring_ctrl->tail = dev.ring_ctrl->head;
+	CHECK(!pop(&dev, dst, &frame));
+	CHECK(dev.frame_tail == dev.frame_head);
+	dev_free(&dev);
+}
+
+/*TX queue of slots frames, counters at pos, window idle*/
+static void tx_init(struct plat_dummy_device *dev, u32 slots, u32 pos)
+{
+	memset(dev, 0, sizeof(*dev));
+	dev->tx_slots = slots;
+	dev->tx_buf = calloc(slots, MEM_SIZE);
+	dev->tx_len = calloc(slots, sizeof(*dev->tx_len));
+	dev->tx_ctrl = calloc(1, sizeof(*dev->tx_ctrl) +
+			      slots * sizeof(dev->tx_ctrl->len[0]));
+	if (!dev->tx_buf || !dev->tx_len || !dev->tx_ctrl) {
+		perror("calloc");
+		exit(1);
+	}
+	dev->tx_head = dev->tx_tail = pos;
+	dev->tx_ctrl->head = dev->tx_ctrl->tail = pos;
+	dev->tx_ctrl->slots = slots;
+	dev->tx_ctrl->slot_size = MEM_SIZE;
+}
+
+static void tx_free(struct plat_dummy_device *dev)
+{
+	free(dev->tx_buf);
+	free(dev->tx_len);
+	free(dev->tx_ctrl);
+}
+
+/*plat_dummy_write() for one segment, false when the queue is full*/
+static bool tx_write(struct plat_dummy_device *dev, const char *src, u32 seg,
+		     u32 coalesce)
+{
+	if (!plat_dummy_tx_fits(dev, seg))
+		plat_dummy_tx_publish(dev);
+	if (plat_dummy_tx_full(dev))
+		return false;
+	memcpy((char *)plat_dummy_tx_slot(dev, dev->tx_head) + dev->tx_fill,
+	       src, seg);
+	if (plat_dummy_tx_filled(dev, seg, coalesce))
+		plat_dummy_tx_publish(dev);
+	return true;
+}
+
+/*plat_dummy_tx_once() with dst in place of the window*/
+static bool tx_send(struct plat_dummy_device *dev, char *dst, u32 *len)
+{
+	u32 tail = dev->tx_tail;
+
+	if (smp_load_acquire(&dev->tx_head) == tail) {
+		plat_dummy_tx_sync(dev);
+		if (dev->tx_head == tail)
+			return false;
+	}
+	*len = dev->tx_len[tail & (dev->tx_slots - 1)];
+	memcpy(dst, plat_dummy_tx_slot(dev, tail), *len);
+	plat_dummy_tx_consume(dev);
+	return true;
+}
+
+/*Fill every slot and send them all, counters start at start*/
+static void test_tx_queue(u32 start)
+{
+	struct plat_dummy_device dev;
+	char src[MEM_SIZE], dst[MEM_SIZE];
+	u32 i, len;
+
+	tx_init(&dev, 4, start);
+	CHECK(plat_dummy_tx_depth(&dev) == 0);
+	CHECK(!plat_dummy_tx_full(&dev));
+	CHECK(!tx_send(&dev, dst, &len));
+
+	for (i = 0; i < 4; i++) {
+		memset(src, i, sizeof(src));
+		CHECK(tx_write(&dev, src, 100 + i, 0));
+		CHECK(plat_dummy_tx_depth(&dev) == i + 1);
+		CHECK(dev.tx_ctrl->head == dev.tx_head);
+	}
+	CHECK(plat_dummy_tx_full(&dev));
+	CHECK(!tx_write(&dev, src, 1, 0));
+	CHECK(dev.tx_depth_max == 4);
+
+	/* slots are indexed by counter, across the 2^32 wrap too */
+	for (i = 0; i < 4; i++)
+		CHECK(plat_dummy_tx_slot(&dev, start + i) ==
+		      dev.tx_buf + ((start + i) & 3) * MEM_SIZE);
+
+	for (i = 0; i < 4; i++) {
+		CHECK(tx_send(&dev, dst, &len));
+		CHECK(len == 100 + i && dst[0] == (char)i && dst[len - 1] == (char)i);
+		CHECK(!plat_dummy_tx_full(&dev));
+		CHECK(dev.tx_ctrl->tail == dev.tx_tail);
+	}
+	CHECK(!tx_send(&dev, dst, &len));
+	CHECK(plat_dummy_tx_depth(&dev) == 0);
+	CHECK(dev.tx_tail == start + 4);
+	tx_free(&dev);
+}
+
+/*Small writes are packed into one slot until coalesce bytes*/
+static void test_tx_coalesce(void)
+{
+	struct plat_dummy_device dev;
+	char src[MEM_SIZE] = { 0 }, dst[MEM_SIZE];
+	u32 len;
+
+	tx_init(&dev, 4, 0);
+	CHECK(tx_write(&dev, "ab", 2, 100));
+	CHECK(tx_write(&dev, "cd", 2, 100));
+	CHECK(plat_dummy_tx_depth(&dev) == 0 && dev.tx_fill == 4);
+	CHECK(tx_write(&dev, src, 96, 100));
+	CHECK(plat_dummy_tx_depth(&dev) == 1 && dev.tx_fill == 0);
+	CHECK(tx_send(&dev, dst, &len));
+	CHECK(len == 100 && !memcmp(dst, "abcd", 4));
+
+	/* what doesn't fit goes to the next slot, the open one goes out */
+	CHECK(tx_write(&dev, src, MEM_SIZE - 10, MEM_SIZE));
+	CHECK(plat_dummy_tx_fits(&dev, 10));
+	CHECK(!plat_dummy_tx_fits(&dev, 11));
+	CHECK(tx_write(&dev, src, 11, MEM_SIZE));
+	CHECK(plat_dummy_tx_depth(&dev) == 1 && dev.tx_fill == 11);
+	CHECK(tx_send(&dev, dst, &len) && len == MEM_SIZE - 10);
+	tx_free(&dev);
+}
+
+/*Frames committed through the mmap()ed ctrl page*/
+static void test_tx_sync(void)
+{
+	struct plat_dummy_device dev;
+	char dst[MEM_SIZE];
+	u32 len, head;
+
+	tx_init(&dev, 4, UINT32_MAX - 1);
+	head = dev.tx_ctrl->head;
+	dev.tx_ctrl->len[head & 3] = 10;
+	dev.tx_ctrl->len[(head + 1) & 3] = MEM_SIZE + 1;
+	smp_store_release(&dev.tx_ctrl->head, head + 2);
+
+	CHECK(tx_send(&dev, dst, &len) && len == 10);
+	CHECK(plat_dummy_tx_depth(&dev) == 1);
+	/* lengths are clamped to a slot */
+	CHECK(tx_send(&dev, dst, &len) && len == MEM_SIZE);
+	CHECK(!tx_send(&dev, dst, &len));
+
+	/* more than the queue holds or behind the driver: ignored */
+	dev.tx_ctrl->head = dev.tx_tail + 5;
+	CHECK(!tx_send(&dev, dst, &len));
+	dev.tx_ctrl->head = dev.tx_tail - 1;
+	CHECK(!tx_send(&dev, dst, &len));
+	CHECK(dev.tx_head == dev.tx_tail);
+
+	/* write() after the mapping is gone: its frames go first */
+	dev.tx_ctrl->head = dev.tx_head;
+	dev.tx_ctrl->len[dev.tx_head & 3] = 7;
+	dev.tx_ctrl->head++;
+	plat_dummy_tx_sync(&dev);
+	CHECK(tx_write(&dev, dst, 8, 0));
+	CHECK(dev.tx_ctrl->head == dev.tx_head);
+	CHECK(tx_send(&dev, dst, &len) && len == 7);
+	CHECK(tx_send(&dev, dst, &len) && len == 8);
+	tx_free(&dev);
+}
+
+/*
+ * One TX frame and the RX frame after it through the window. Devices
+ * without TX_DONE clear DATA_READY when they take the frame, the others
+ * set TX_DONE and may post RX at once.
+ */
+static void test_window(bool has_tx_done)
+{
+	struct plat_dummy_device dev;
+	u32 status = PLAT_WRITE_READY, len;
+	char dst[MEM_SIZE];
+
+	tx_init(&dev, 4, 0);
+	dev.has_tx_done = has_tx_done;
+	CHECK(!plat_dummy_tx_ready(&dev, status));
+	CHECK(tx_write(&dev, "x", 1, 0));
+	CHECK(plat_dummy_tx_ready(&dev, status));
+	CHECK(!plat_dummy_irq_pending(&dev, status));
+
+	/* host posts, the frame in the window is ours until taken */
+	CHECK(plat_dummy_win_free(status) && tx_send(&dev, dst, &len));
+	status = plat_dummy_tx_post(&dev, status);
+	CHECK(status == PLAT_IO_DATA_READY && dev.tx_busy);
+	status = plat_dummy_tx_complete(&dev, status);
+	CHECK(dev.tx_busy);
+	CHECK(!plat_dummy_rx_pending(&dev, status));
+	CHECK(!plat_dummy_irq_pending(&dev, status));
+	CHECK(!plat_dummy_win_free(status));
+
+	if (has_tx_done) {
+		/* taken and RX posted before the host looked */
+		status |= PLAT_TX_DONE;
+		CHECK(plat_dummy_irq_pending(&dev, status));
+		status = plat_dummy_tx_complete(&dev, status);
+		CHECK(status == PLAT_IO_DATA_READY && !dev.tx_busy);
+	} else {
+		/* bit 2 is reserved, it doesn't complete anything */
+		status = plat_dummy_tx_complete(&dev, status | PLAT_TX_DONE);
+		CHECK(dev.tx_busy);
+		CHECK(!plat_dummy_irq_pending(&dev, status));
+		status = PLAT_WRITE_READY;		/* device took it */
+		status = plat_dummy_tx_complete(&dev, status);
+		CHECK(!dev.tx_busy && plat_dummy_win_free(status));
+		status = PLAT_IO_DATA_READY;		/* device posts RX */
+		status = plat_dummy_tx_complete(&dev, status);
+	}
+	CHECK(plat_dummy_rx_pending(&dev, status));
+	CHECK(plat_dummy_irq_pending(&dev, status));
+
+	/* host took the RX frame: window is free again */
+	status = plat_dummy_rx_release(status);
+	CHECK(status == PLAT_WRITE_READY);
+	CHECK(!plat_dummy_rx_pending(&dev, status));
+	CHECK(!plat_dummy_irq_pending(&dev, status));
+	CHECK(!plat_dummy_tx_ready(&dev, status));
+	tx_free(&dev);
+}
+
+/*Frame content is a function of its seq, so the consumer can check it*/
+static u32 frame_len(u32 seq)
+{
+	return 1 + (seq * 2654435761u >> 20) % 4096;
+}
+
+static void frame_fill(char *buf, u32 seq)
+{
+	u32 i, len = frame_len(seq);
+
+	for (i = 0; i < len; i++)
+		buf[i] = seq + i;
+}
+
+struct stress {
+	struct plat_dummy_device dev;
+	int done;
+	u64 push_ns;
+	u64 bytes;
+};
+
+static void *producer(void *arg)
+{
+	struct stress *s = arg;
+	char buf[4096];
+	u64 t0;
+	u32 seq;
+
+	t0 = now_ns();
+	for (seq = 0; seq < STRESS_FRAMES; seq++) {
+		frame_fill(buf, seq);
+		while (!push(&s->dev, buf, frame_len(seq)))
+			sched_yield();
+		s->bytes += frame_len(seq);
+	}
+	s->push_ns = now_ns() - t0;
+	__atomic_store_n(&s->done, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+static void test_stress(void)
+{
+	struct plat_dummy_frame frame;
+	struct stress s = { 0 };
+	char dst[4096], ref[4096];
+	u64 frames = 0, lost = 0, t0, pop_ns;
+	u32 next = 0;
+	pthread_t tid;
+
+	dev_init(&s.dev, RING_SIZE, UINT32_MAX - RING_SIZE);
+	if (pthread_create(&tid, NULL, producer, &s)) {
+		perror("pthread_create");
+		exit(1);
+	}
+
+	t0 = now_ns();
+	for (;;) {
+		if (!pop(&s.dev, dst, &frame)) {
+			/* done first: all frames are visible after it */
+			if (!__atomic_load_n(&s.done, __ATOMIC_ACQUIRE)) {
+				sched_yield();
+				continue;
+			}
+			if (!pop(&s.dev, dst, &frame))
+				break;
+		}
+		/* gaps are frames whose entries were reused, never reorders */
+		if ((s32)(frame.seq - next) < 0) {
+			CHECK(!"frame seq went back");
+			break;
+		}
+		lost += frame.seq - next;
+		next = frame.seq + 1;
+		frames++;
+
+		frame_fill(ref, frame.seq);
+		if (frame.len != frame_len(frame.seq) ||
+		    memcmp(dst, ref, frame.len)) {
+			CHECK(!"frame data corrupted");
+			break;
+		}
+	}
+	pop_ns = now_ns() - t0;
+	pthread_join(tid, NULL);
+
+	CHECK(frames + lost == STRESS_FRAMES);
+	CHECK(plat_dummy_rx_used(&s.dev) == 0);
+	printf("stress: %llu frames, %llu lost, %llu MB, %.2f ns/byte\n",
+	       (unsigned long long)frames, (unsigned long long)lost,
+	       (unsigned long long)(s.bytes >> 20),
+	       (double)(pop_ns > s.push_ns ? pop_ns : s.push_ns) / s.bytes);
+	dev_free(&s.dev);
+}
+
+/*Single threaded cost of push and pop: fill the ring, then drain it*/
+static void bench(u32 size)
+{
+	struct plat_dummy_device dev;
+	struct plat_dummy_frame frame;
+	char buf[4096] = { 0 };
+	u64 bytes = 0, push_ns = 0, pop_ns = 0, t0;
+	u32 i, batch;
+
+	/* stay below the frame table, reused entries would drop frames */
+	batch = min(RING_SIZE / size, PLAT_RX_FRAMES - 1);
+	dev_init(&dev, RING_SIZE, 0);
+	while (bytes < BENCH_BYTES) {
+		t0 = now_ns();
+		for (i = 0; i < batch; i++)
+			push(&dev, buf, size);
+		push_ns += now_ns() - t0;
+		t0 = now_ns();
+		for (i = 0; i < batch; i++)
+			pop(&dev, buf, &frame);
+		pop_ns += now_ns() - t0;
+		bytes += (u64)batch * size;
+	}
+	CHECK(plat_dummy_rx_used(&dev) == 0);
+	printf("bench %4u byte frames: push %.3f ns/byte, pop %.3f ns/byte\n",
+	       size, (double)push_ns / bytes, (double)pop_ns / bytes);
+	dev_free(&dev);
+}
+
+int main(void)
+{
+	test_split();
+	test_full_empty(0);
+	test_full_empty(1000);
+	/* counters wrap past 2^32 in the middle of the ring */
+	test_full_empty(UINT32_MAX - 2047);
+	test_frame_reuse();
+	test_byte_reader();
+	test_tx_queue(0);
+	test_tx_queue(UINT32_MAX - 1);
+	test_tx_coalesce();
+	test_tx_sync();
+	test_window(false);
+	test_window(true);
+	test_stress();
+	bench(64);
+	bench(1024);
+	bench(4096);
+
+	printf("%s\n", failed ? "FAIL" : "PASS");
+	return !!failed;
+}